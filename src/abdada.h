@@ -0,0 +1,68 @@
+#ifndef ABDADA_H
+#define ABDADA_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace Atom {
+
+// Parallel search strategies of the thread pool.
+// - LAZY_SMP: every thread searches the whole tree, sharing only the TT.
+//   Helpers spread over several depths (see Tunables::SMP_SKIP_SIZE).
+// - ABDADA: every thread searches the same depth, and threads defer the
+//   moves that another thread is already searching to the end of their move
+//   loop, so they split the tree between them instead of duplicating work.
+enum class ParallelMode {
+    LAZY_SMP,
+    ABDADA
+};
+
+
+// Simplified ABDADA side table: the (position, move) pairs that are being
+// searched right now, by any thread. It is lossy: a pair that collides with
+// another one simply overwrites it, which at worst makes a thread search a
+// move that it could have deferred.
+class SearchingTable {
+public:
+    static constexpr size_t SIZE = 1 << 15;
+
+    SearchingTable() { clear(); }
+
+    // Key of a move in a position, never zero for a legal move
+    static inline uint64_t moveKey(uint64_t hash, Move m) {
+        return hash ^ (uint64_t(m) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    inline bool isSearching(uint64_t key) const {
+        return slot(key).load(std::memory_order_relaxed) == key;
+    }
+
+    inline void startSearching(uint64_t key) {
+        slot(key).store(key, std::memory_order_relaxed);
+    }
+
+    // Only clears the slot if it has not been taken by another pair since
+    inline void finishSearching(uint64_t key) {
+        slot(key).compare_exchange_strong(key, 0, std::memory_order_relaxed);
+    }
+
+    void clear() {
+        for (std::atomic<uint64_t>& entry : table) {
+            entry.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    inline std::atomic<uint64_t>&       slot(uint64_t key)       { return table[key & (SIZE - 1)]; }
+    inline const std::atomic<uint64_t>& slot(uint64_t key) const { return table[key & (SIZE - 1)]; }
+
+    std::array<std::atomic<uint64_t>, SIZE> table;
+};
+
+} // namespace Atom
+
+#endif // ABDADA_H
@@ -0,0 +1,214 @@
+#include <iostream>
+
+#include "alloccount.h"
+
+#if defined(ALLOC_COUNT)
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace Atom {
+
+namespace AllocCount {
+
+namespace {
+
+constexpr int STACK_DEPTH  = 8;    // Frames kept for each call site
+constexpr int SKIP_FRAMES  = 3;    // record(), allocate() and operator new
+constexpr int MAX_SITES    = 256;
+
+struct Site {
+    uint64_t count, bytes;
+    int      nbFrames;
+    void*    frames[STACK_DEPTH];
+};
+
+// Sites are looked up under a lock: this build is only used to find
+// allocations, not to measure speed
+std::mutex mutex;
+Site       sites[MAX_SITES];
+int        nbSites;
+uint64_t   nbAllocs, nbBytes, nbUnrecorded;
+
+thread_local bool counting = false;
+
+
+[[gnu::noinline]] void record(size_t size) {
+    // backtrace() may allocate the first time it runs in a thread
+    counting = false;
+
+    void* frames[SKIP_FRAMES + STACK_DEPTH];
+    const int n        = backtrace(frames, SKIP_FRAMES + STACK_DEPTH);
+    const int nbFrames = std::max(n - SKIP_FRAMES, 0);
+
+    {
+        std::lock_guard lock(mutex);
+
+        ++nbAllocs;
+        nbBytes += size;
+
+        Site* site = std::find_if(sites, sites + nbSites, [&](const Site& s) {
+            return s.nbFrames == nbFrames && std::equal(s.frames, s.frames + nbFrames, frames + SKIP_FRAMES);
+        });
+
+        if (site == sites + nbSites) {
+            if (nbSites == MAX_SITES) {
+                ++nbUnrecorded;
+                site = nullptr;
+            } else {
+                site = &sites[nbSites++];
+                *site = {0, 0, nbFrames, {}};
+                std::copy(frames + SKIP_FRAMES, frames + SKIP_FRAMES + nbFrames, site->frames);
+            }
+        }
+
+        if (site) {
+            ++site->count;
+            site->bytes += size;
+        }
+    }
+
+    counting = true;
+}
+
+
+[[gnu::noinline]] void* allocate(size_t size) {
+    if (counting) record(size);
+
+    void* p = std::malloc(std::max<size_t>(size, 1));
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+
+[[gnu::noinline]] void* allocate(size_t size, std::align_val_t alignment) {
+    if (counting) record(size);
+
+    // aligned_alloc wants a multiple of the alignment
+    const size_t align = std::max(size_t(alignment), sizeof(void*));
+    void* p = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+
+// "binary(mangled+offset) [address]" -> "demangled+offset"
+std::string frameName(const char* symbol) {
+    const char* begin = std::strchr(symbol, '(');
+    const char* end   = begin ? std::strchr(begin, '+') : nullptr;
+
+    if (!begin || !end || end == begin + 1) return symbol;
+
+    const std::string mangled(begin + 1, end);
+    int status;
+    char* demangled = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+
+    std::string name = status == 0 ? demangled : mangled;
+    std::free(demangled);
+
+    return name + std::string(end, std::strcspn(end, ")"));
+}
+
+} // namespace
+
+
+Scope::Scope() : wasCounting(counting) {
+    counting = true;
+}
+
+
+Scope::~Scope() {
+    counting = wasCounting;
+}
+
+
+void reset() {
+    // Loads what backtrace() needs now, rather than inside a search
+    void* frame;
+    backtrace(&frame, 1);
+
+    std::lock_guard lock(mutex);
+    nbSites  = 0;
+    nbAllocs = nbBytes = nbUnrecorded = 0;
+}
+
+
+void report() {
+    std::lock_guard lock(mutex);
+
+    std::cout << std::endl;
+    std::cout << "Allocations on search threads: " << nbAllocs << " (" << nbBytes << " bytes)" << std::endl;
+
+    if (nbUnrecorded) {
+        std::cout << "Allocations from unrecorded sites: " << nbUnrecorded << std::endl;
+    }
+
+    Site* sorted[MAX_SITES];
+    std::transform(sites, sites + nbSites, sorted, [](Site& s) { return &s; });
+    std::sort(sorted, sorted + nbSites, [](const Site* a, const Site* b) { return a->count > b->count; });
+
+    for (int i = 0; i < nbSites; ++i) {
+        const Site& s = *sorted[i];
+        std::cout << std::endl << s.count << " allocations, " << s.bytes << " bytes" << std::endl;
+
+        char** symbols = backtrace_symbols(s.frames, s.nbFrames);
+        for (int f = 0; f < s.nbFrames; ++f) {
+            std::cout << "    " << (symbols ? frameName(symbols[f]) : "?") << std::endl;
+        }
+        std::free(symbols);
+    }
+}
+
+} // namespace AllocCount
+
+} // namespace Atom
+
+
+// Replacements of the global allocation functions. The array and nothrow
+// versions are replaced too, as the library ones may not call these.
+void* operator new  (size_t size)                                       { return Atom::AllocCount::allocate(size); }
+void* operator new[](size_t size)                                       { return Atom::AllocCount::allocate(size); }
+void* operator new  (size_t size, std::align_val_t al)                  { return Atom::AllocCount::allocate(size, al); }
+void* operator new[](size_t size, std::align_val_t al)                  { return Atom::AllocCount::allocate(size, al); }
+
+void* operator new  (size_t size, const std::nothrow_t&) noexcept {
+    try { return Atom::AllocCount::allocate(size); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try { return Atom::AllocCount::allocate(size); } catch (...) { return nullptr; }
+}
+
+// Everything comes from malloc or aligned_alloc, both freed with free()
+void operator delete  (void* p) noexcept                                { std::free(p); }
+void operator delete[](void* p) noexcept                                { std::free(p); }
+void operator delete  (void* p, size_t) noexcept                        { std::free(p); }
+void operator delete[](void* p, size_t) noexcept                        { std::free(p); }
+void operator delete  (void* p, std::align_val_t) noexcept              { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept              { std::free(p); }
+void operator delete  (void* p, size_t, std::align_val_t) noexcept      { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept      { std::free(p); }
+
+#else
+
+namespace Atom {
+
+namespace AllocCount {
+
+void reset() {}
+
+void report() {
+    std::cout << "Allocation counting is not compiled in, build with 'make debug ALLOC_COUNT=yes'" << std::endl;
+}
+
+} // namespace AllocCount
+
+} // namespace Atom
+
+#endif
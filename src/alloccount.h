@@ -0,0 +1,43 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+namespace Atom {
+
+namespace AllocCount {
+
+// Heap allocation counter, to check that the search does not allocate.
+//
+// Only compiled in with ALLOC_COUNT=yes (see Makefile), which replaces the
+// global operator new. Allocations are then counted on the threads that are
+// inside a Scope: the search threads open one from go until bestmove. The
+// allocstats command prints the count of the last search and where the
+// allocations were made. Use a debug build, so that call sites have names.
+
+#if defined(ALLOC_COUNT)
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+
+// Counts the allocations made by the calling thread while it is alive
+class Scope {
+public:
+#if defined(ALLOC_COUNT)
+    Scope();
+    ~Scope();
+
+private:
+    bool wasCounting;
+#endif
+};
+
+
+void reset();   // Forgets the counts, called at each go
+void report();  // Prints the counts and call sites since the last reset
+
+} // namespace AllocCount
+
+} // namespace Atom
+
+#endif // ALLOCCOUNT_H
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "bench.h"
+#include "engine.h"
+#include "search.h"
+#include "thread.h"
+#include "tt.h"
+#include "types.h"
+
+namespace Atom {
+
+// Fixed set of positions used for benchmarking.
+// Mostly taken from the stockfish bench.
+const std::vector<std::string> BENCH_FENS = {
+    STARTPOS_FEN,
+    KIWIPETE_FEN,
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 7 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 2 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 2 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 1 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 1 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 1 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 6 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 2 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 3 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 4 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+};
+
+
+// Searches every bench position to the given depth, once for each hash size.
+// The transposition table is cleared between hash sizes, but not between
+// positions, so later positions run with a partially filled table.
+//
+// The TT layout is fixed at compile time: to compare layouts, build with
+// each TT_LAYOUT (see Makefile) and run the same bench command.
+// Likewise, run it with and without QSearchHash set to compare the main
+// table hit rate when the quiescence search has its own table. Small hash
+// sizes show the effect of a heavily loaded table best.
+void bench(Engine& engine, Depth depth, const std::vector<size_t>& hashSizes) {
+
+    struct BenchResult {
+        size_t   hashSize;
+        uint64_t nodes;
+        TimePoint elapsed;
+        TTStats  ttStats;
+        TTStats  qttStats;
+        Eval::EvalCacheStats evalCacheStats;
+        Search::CutoffStats cutoffStats;
+    };
+
+    std::vector<BenchResult> results;
+
+    for (const size_t hashSize : hashSizes) {
+        BenchResult result = {hashSize, 0, 0, TTStats(), TTStats(), Eval::EvalCacheStats(), Search::CutoffStats()};
+
+        engine.setHashSize(hashSize);
+        engine.clear();
+
+        for (const std::string& fen : BENCH_FENS) {
+            Search::SearchLimits limits;
+            limits.depth = depth;
+
+            engine.setPosition(fen, {});
+
+            limits.startTimePoint = now();
+            engine.go(limits);
+            engine.waitForSearchFinish();
+
+            result.elapsed += now() - limits.startTimePoint;
+            result.nodes   += engine.nodesSearched();
+            result.ttStats  += engine.getTTStats();
+            result.qttStats += engine.getQTTStats();
+            result.evalCacheStats += engine.getEvalCacheStats();
+            result.cutoffStats += engine.getCutoffStats();
+        }
+
+        results.push_back(result);
+    }
+
+    std::cout << std::endl;
+    std::cout << "TT layout:    " << TT_LAYOUT_NAME << std::endl;
+    std::cout << "QSearch hash: " << engine.getQSearchHashSize() << " MB" << std::endl;
+    std::cout << "Depth:        " << depth << std::endl;
+    std::cout << "Positions:    " << BENCH_FENS.size() << std::endl;
+    std::cout << std::endl;
+    std::cout << "  Hash (MB)   Time (ms)        Nodes         NPS   Hit rate   Collisions   QS hit rate   Eval hit rate   1st move cuts" << std::endl;
+
+    for (const BenchResult& r : results) {
+        const double hitRate       = r.ttStats.probes ? 100.0 * r.ttStats.hits / r.ttStats.probes : 0.0;
+        const double collisionRate = r.ttStats.hits ? 100.0 * r.ttStats.collisions / r.ttStats.hits : 0.0;
+        const double qsHitRate     = r.qttStats.probes ? 100.0 * r.qttStats.hits / r.qttStats.probes : 0.0;
+        const double evalHitRate   = r.evalCacheStats.probes ? 100.0 * r.evalCacheStats.hits / r.evalCacheStats.probes : 0.0;
+        const double firstCutRate  = r.cutoffStats.cutoffs ? 100.0 * r.cutoffStats.firstMoveCutoffs / r.cutoffStats.cutoffs : 0.0;
+
+        std::cout << std::setw(11) << r.hashSize
+                  << std::setw(12) << r.elapsed
+                  << std::setw(13) << r.nodes
+                  << std::setw(12) << r.nodes * 1000 / std::max<TimePoint>(r.elapsed, 1)
+                  << std::setw(10) << std::fixed << std::setprecision(2) << hitRate << "%"
+                  << std::setw(12) << std::fixed << std::setprecision(4) << collisionRate << "%"
+                  << std::setw(13) << std::fixed << std::setprecision(2) << qsHitRate << "%"
+                  << std::setw(15) << std::fixed << std::setprecision(2) << evalHitRate << "%"
+                  << std::setw(15) << std::fixed << std::setprecision(2) << firstCutRate << "%"
+                  << std::endl;
+    }
+}
+
+
+
+// Measures the latency of the thread pool: the time from go until the first
+// thread and all threads have started searching, and from stop until bestmove
+// has been sent. Each iteration runs an infinite search from the start
+// position and stops it after a short time.
+void latency(Engine& engine, int iterations) {
+
+    struct LatencyStats {
+        int64_t sum = 0, max = 0;
+
+        void add(int64_t t) { sum += t; max = std::max(max, t); }
+    } goToFirstNode, goToAllStarted, stopToBestMove;
+
+    for (int i = 0; i < iterations; ++i) {
+        Search::SearchLimits limits;
+        limits.isInfinite = true;
+
+        engine.setPosition(STARTPOS_FEN, {});
+
+        limits.startTimePoint = now();
+        engine.go(limits);
+        std::this_thread::sleep_for(std::chrono::milliseconds(LATENCY_SEARCH_TIME));
+        engine.stop();
+        engine.waitForSearchFinish();
+
+        const SearchLatency l = engine.getLatency();
+        goToFirstNode.add(l.goToFirstNode);
+        goToAllStarted.add(l.goToAllStarted);
+        stopToBestMove.add(l.stopToBestMove);
+    }
+
+    std::cout << std::endl;
+    std::cout << "Threads:    " << engine.getNbThreads() << std::endl;
+    std::cout << "Iterations: " << iterations << std::endl;
+    std::cout << std::endl;
+    std::cout << "                       Avg (us)    Max (us)" << std::endl;
+
+    for (const auto& [name, stats] : {
+        std::pair{"go -> first node  ", goToFirstNode},
+        std::pair{"go -> all started ", goToAllStarted},
+        std::pair{"stop -> bestmove  ", stopToBestMove},
+    }) {
+        std::cout << name
+                  << std::setw(13) << stats.sum / std::max(iterations, 1)
+                  << std::setw(12) << stats.max
+                  << std::endl;
+    }
+}
+
+
+
+// Measures how the node rate scales with the number of threads. Every bench
+// position is searched for a fixed time with each thread count, so the NPS
+// reported is directly comparable between thread counts and between builds.
+// Ideally it grows linearly with the thread count; any shortfall beyond what
+// the machine's core count explains is contention between the workers.
+void npsScaling(Engine& engine, TimePoint searchTime, const std::vector<size_t>& threadCounts) {
+
+    struct NpsResult {
+        size_t   nbThreads;
+        uint64_t nodes;
+        TimePoint elapsed;
+    };
+
+    std::vector<NpsResult> results;
+
+    for (const size_t nbThreads : threadCounts) {
+        NpsResult result = {nbThreads, 0, 0};
+
+        engine.setNbThreads(nbThreads);
+        engine.clear();
+
+        for (const std::string& fen : BENCH_FENS) {
+            Search::SearchLimits limits;
+            limits.isInfinite = true;
+
+            engine.setPosition(fen, {});
+
+            limits.startTimePoint = now();
+            engine.go(limits);
+            std::this_thread::sleep_for(std::chrono::milliseconds(searchTime));
+            engine.stop();
+            engine.waitForSearchFinish();
+
+            result.elapsed += now() - limits.startTimePoint;
+            result.nodes   += engine.nodesSearched();
+        }
+
+        results.push_back(result);
+    }
+
+    std::cout << std::endl;
+    std::cout << "Search time: " << searchTime << " ms per position" << std::endl;
+    std::cout << "Positions:   " << BENCH_FENS.size() << std::endl;
+    std::cout << std::endl;
+    std::cout << "  Threads        Nodes         NPS   NPS / thread   Speedup" << std::endl;
+
+    const double baseNps = results.empty() ? 0.0
+                         : double(results[0].nodes) * 1000 / std::max<TimePoint>(results[0].elapsed, 1);
+
+    for (const NpsResult& r : results) {
+        const double nps = double(r.nodes) * 1000 / std::max<TimePoint>(r.elapsed, 1);
+
+        std::cout << std::setw(9) << r.nbThreads
+                  << std::setw(13) << r.nodes
+                  << std::setw(12) << uint64_t(nps)
+                  << std::setw(15) << uint64_t(nps / r.nbThreads)
+                  << std::setw(9) << std::fixed << std::setprecision(2) << (baseNps > 0 ? nps / baseNps : 0.0) << "x"
+                  << std::endl;
+    }
+}
+
+
+
+// Measures whether extra threads actually help the search. Every bench
+// position is searched to a fixed depth with each thread count, reporting:
+// - the time to depth, and the speedup over the first thread count,
+// - how often the best move is the same as with the first thread count,
+// - the share of the threads whose own best move was the one played.
+void smpScaling(Engine& engine, Depth depth, const std::vector<size_t>& threadCounts) {
+
+    struct SmpResult {
+        size_t    nbThreads;
+        TimePoint elapsed;
+        uint64_t  nodes;
+        size_t    sameMove;
+        size_t    nbAgreeing, nbVoting;
+    };
+
+    std::vector<SmpResult> results;
+    std::vector<Move>      referenceMoves;
+
+    for (const size_t nbThreads : threadCounts) {
+        SmpResult result = {nbThreads, 0, 0, 0, 0, 0};
+
+        engine.setNbThreads(nbThreads);
+
+        for (size_t i = 0; i < BENCH_FENS.size(); ++i) {
+            Search::SearchLimits limits;
+            limits.depth = depth;
+
+            // Every search starts from an empty table, or later thread counts
+            // would benefit from the entries of the earlier ones
+            engine.clear();
+            engine.setPosition(BENCH_FENS[i], {});
+
+            limits.startTimePoint = now();
+            engine.go(limits);
+            engine.waitForSearchFinish();
+
+            const SearchAgreement agreement = engine.getAgreement();
+
+            result.elapsed    += now() - limits.startTimePoint;
+            result.nodes      += engine.nodesSearched();
+            result.nbAgreeing += agreement.nbAgreeing;
+            result.nbVoting   += agreement.nbVoting;
+
+            if (referenceMoves.size() < BENCH_FENS.size()) {
+                referenceMoves.push_back(agreement.bestMove);
+            }
+            result.sameMove += agreement.bestMove == referenceMoves[i];
+        }
+
+        results.push_back(result);
+    }
+
+    std::cout << std::endl;
+    std::cout << "Mode:      " << (engine.getParallelMode() == ParallelMode::ABDADA ? "ABDADA" : "LazySMP") << std::endl;
+    std::cout << "Depth:     " << depth << std::endl;
+    std::cout << "Positions: " << BENCH_FENS.size() << std::endl;
+    std::cout << std::endl;
+    std::cout << "  Threads   Time (ms)        Nodes   Speedup   Same move   Agreement" << std::endl;
+
+    for (const SmpResult& r : results) {
+        const double speedup   = double(results[0].elapsed) / std::max<TimePoint>(r.elapsed, 1);
+        const double sameMove  = 100.0 * r.sameMove / BENCH_FENS.size();
+        const double agreement = r.nbVoting ? 100.0 * r.nbAgreeing / r.nbVoting : 0.0;
+
+        std::cout << std::setw(9) << r.nbThreads
+                  << std::setw(12) << r.elapsed
+                  << std::setw(13) << r.nodes
+                  << std::setw(9) << std::fixed << std::setprecision(2) << speedup << "x"
+                  << std::setw(11) << std::fixed << std::setprecision(1) << sameMove << "%"
+                  << std::setw(11) << std::fixed << std::setprecision(1) << agreement << "%"
+                  << std::endl;
+    }
+}
+
+
+
+
+// Prints how often each search heuristic fired during the last search, to
+// tune the parameters in tunables.h. Each count is given as a rate of what it
+// is out of: the nodes searched, or the times the heuristic was tried.
+//
+// The effective branching factor of a depth is the number of nodes of its
+// iteration over those of the previous one. It is only meaningful with one
+// thread: lazy SMP helpers skip some depths.
+void searchStats(const Engine& engine) {
+    if constexpr (!Search::SEARCH_STATS_ENABLED) {
+        std::cout << "Search statistics are not compiled in, build with 'make release SEARCH_STATS=yes'" << std::endl;
+        return;
+    }
+
+    const Search::SearchStats s       = engine.getSearchStats();
+    const Search::CutoffStats cutoffs = engine.getCutoffStats();
+    const uint64_t            nodes   = engine.nodesSearched();
+
+    std::cout << std::endl;
+    std::cout << "Threads: " << engine.getNbThreads() << std::endl;
+    std::cout << "Nodes:   " << nodes << std::endl;
+    std::cout << std::endl;
+    std::cout << "  Heuristic                     Count            Out of      Rate" << std::endl;
+
+    for (const auto& [name, count, total] : {
+        std::tuple{"Reverse futility pruning ", s.rfp,                  nodes},
+        std::tuple{"Razoring cutoffs         ", s.razoringCuts,         s.razoringTries},
+        std::tuple{"Futility pruning         ", s.futility,             nodes},
+        std::tuple{"Null move cutoffs        ", s.nmpCuts,              s.nmpTries},
+        std::tuple{"NMP verification fails   ", s.nmpVerificationFails, s.nmpVerifications},
+        std::tuple{"ProbCut cutoffs          ", s.probcutCuts,          s.probcutTries},
+        std::tuple{"Late move pruning        ", s.lmp,                  nodes},
+        std::tuple{"SEE pruning              ", s.seePruned,            nodes},
+        std::tuple{"LMR re-searches          ", s.lmrResearches,        s.lmrSearches},
+        std::tuple{"First move beta cutoffs  ", cutoffs.firstMoveCutoffs, cutoffs.cutoffs},
+        std::tuple{"Aspiration fail lows     ", s.aspirationFailLows,   s.aspirationFailLows + s.aspirationFailHighs},
+        std::tuple{"Aspiration fail highs    ", s.aspirationFailHighs,  s.aspirationFailLows + s.aspirationFailHighs},
+    }) {
+        std::cout << "  " << name
+                  << std::setw(13) << count
+                  << std::setw(18) << total
+                  << std::setw(9) << std::fixed << std::setprecision(2) << (total ? 100.0 * count / total : 0.0) << "%"
+                  << std::endl;
+    }
+
+    std::cout << std::endl;
+    std::cout << "  Depth        Nodes      EBF" << std::endl;
+
+    for (size_t d = 1; d < s.iterationNodes.size() && s.iterationNodes[d]; ++d) {
+        const uint64_t prevNodes = s.iterationNodes[d - 1];
+
+        std::cout << std::setw(7) << d
+                  << std::setw(13) << s.iterationNodes[d];
+
+        if (prevNodes) {
+            std::cout << std::setw(9) << std::fixed << std::setprecision(2) << double(s.iterationNodes[d]) / prevNodes;
+        }
+        std::cout << std::endl;
+    }
+}
+
+} // namespace Atom
@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "engine.h"
+#include "search.h"
+#include "types.h"
+
+namespace Atom {
+
+constexpr Depth BENCH_DEFAULT_DEPTH = 10;
+
+constexpr int LATENCY_DEFAULT_ITERATIONS = 20;
+constexpr int LATENCY_SEARCH_TIME        = 10;  // ms
+
+constexpr TimePoint NPS_DEFAULT_SEARCH_TIME = 1000;  // ms per position
+
+constexpr Depth SMP_DEFAULT_DEPTH = 12;
+
+void bench(Engine& engine, Depth depth, const std::vector<size_t>& hashSizes);
+void latency(Engine& engine, int iterations);
+void npsScaling(Engine& engine, TimePoint searchTime, const std::vector<size_t>& threadCounts);
+void smpScaling(Engine& engine, Depth depth, const std::vector<size_t>& threadCounts);
+void searchStats(const Engine& engine);
+
+} // namespace Atom
+
+#endif // BENCH_H
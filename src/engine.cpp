@@ -22,9 +22,10 @@ Engine::Engine() :
         NNUE::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NNUE::EmbeddedNNUEType::BIG),
         NNUE::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NNUE::EmbeddedNNUEType::SMALL)
         )
-    ) {
+    ),
+    qtt(QTT_DEFAULT_SIZE) {
     loadNetworks();
-    Search::SearchWorkerShared sharedState = {threads, networks, tt};
+    Search::SearchWorkerShared sharedState = {threads, networks, tt, qtt, mateTable};
     threads.setNbThreads(NB_THREADS_DEFAULT, sharedState);
 }
 
@@ -33,6 +34,8 @@ Engine::Engine() :
 void Engine::newGame() {
     pos.setFromFEN(STARTPOS_FEN);
     tt.clear();
+    qtt.clear();
+    mateTable.clear();
     threads.clearThreads();
 }
 
@@ -109,7 +112,12 @@ void Engine::go(Search::SearchLimits limits) {
 
 
 void Engine::stop() {
-    threads.shouldStop = true;
+    threads.stop();
+}
+
+
+void Engine::ponderhit() {
+    threads.ponderhit();
 }
 
 
@@ -120,13 +128,15 @@ void Engine::traceEval() {
 
 
 void Engine::waitForSearchFinish() {
-    threads.firstThread()->waitForFinish();
+    threads.waitForFinish();
 }
 
 
 void Engine::clear() {
     waitForSearchFinish();
     tt.clear();
+    qtt.clear();
+    mateTable.clear();
     threads.clearThreads();
 }
 
@@ -1,12 +1,14 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <string_view>
 #include <vector>
 
 #include "bitboard.h"
+#include "mate.h"
 #include "nnue/network.h"
 #include "search.h"
 #include "thread.h"
@@ -44,17 +46,40 @@ public:
     // Runs respective UCI commands
     void go(Search::SearchLimits limits);
     void stop();
+    void ponderhit();
     void traceEval();
     void newGame();
     void clear();
 
     // Set aspects of engine
-    inline void setHashSize(size_t newSize) { tt.resize(newSize); }
-    inline void setNbThreads(size_t nbThreads) { threads.setNbThreads(nbThreads, {threads, networks, tt}); }
+    inline void setHashSize(size_t newSize) { tt.resize(newSize, threads.size(), keepHashOnResize); }
+    inline void setKeepHashOnResize(bool keep) { keepHashOnResize = keep; }
+    inline size_t getHashSize() const { return tt.size() * sizeof(TTCluster) / (1024 * 1024); }
+    inline void setQSearchHashSize(size_t newSize) { qtt.resize(newSize); }
+    inline size_t getQSearchHashSize() const { return qtt.size() * sizeof(TTCluster) / (1024 * 1024); }
+    inline void setMateHashSize(size_t newSize) { mateTable.resize(newSize); }
+    inline void setNbThreads(size_t nbThreads) { threads.setNbThreads(nbThreads, {threads, networks, tt, qtt, mateTable}, bindThreads); }
+    inline size_t getNbThreads() const { return threads.size(); }
+    inline void setBindThreads(bool bind) { bindThreads = bind; setNbThreads(threads.size()); }
+    inline void setParallelMode(ParallelMode mode) { threads.parallelMode = mode; }
+    inline ParallelMode getParallelMode() const { return threads.parallelMode; }
+    inline void setMultiPV(size_t n) { threads.multiPV = std::clamp<size_t>(n, 1, MAX_MOVE); }
+    inline size_t getMultiPV() const { return threads.multiPV; }
+    inline void setReportRootMoveNodes(bool report) { threads.reportRootMoveNodes = report; }
 
     // Search
     void waitForSearchFinish();
-    inline bool isSearching() { return threads.firstThread()->isSearching(); }
+    inline bool isSearching() { return threads.isSearching(); }
+
+    // Statistics from the last search (used for benchmarking)
+    inline uint64_t nodesSearched() const { return threads.totalNodesSearched(); }
+    inline TTStats  getTTStats()    const { return threads.totalTTStats(); }
+    inline TTStats  getQTTStats()   const { return threads.totalQTTStats(); }
+    inline Eval::EvalCacheStats getEvalCacheStats() const { return threads.totalEvalCacheStats(); }
+    inline Search::CutoffStats getCutoffStats() const { return threads.totalCutoffStats(); }
+    inline Search::SearchStats getSearchStats() const { return threads.totalSearchStats(); }
+    inline SearchLatency getLatency() const { return threads.getLatency(); }
+    inline SearchAgreement getAgreement() const { return threads.getAgreement(); }
 
 private:
     Position pos;
@@ -62,6 +87,11 @@ private:
     ThreadPool threads;
     NNUE::Networks networks;
     TranspositionTable tt;
+    TranspositionTable qtt;
+    Mate::MateTable mateTable;
+
+    bool keepHashOnResize = false;
+    bool bindThreads      = false;
 };
 
 } // namespace Atom
@@ -2,6 +2,8 @@
 #define EVALUATE_H
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
@@ -67,6 +69,50 @@ Value evaluate(
 }
 
 
+constexpr size_t EVAL_CACHE_ENTRIES = 1 << 16;  // 512 kB per worker
+
+
+struct EvalCacheStats {
+    uint64_t probes = 0;
+    uint64_t hits   = 0;
+
+    inline EvalCacheStats& operator+=(const EvalCacheStats& other) {
+        probes += other.probes;
+        hits   += other.hits;
+        return *this;
+    }
+};
+
+
+// Results of evaluate(), indexed by position hash. Positions often come back
+// after their TT entry (and the eval stored in it) has been replaced, and the
+// cache then saves running the network again. Each worker has its own cache,
+// so entries need no locking.
+class EvalCache {
+public:
+    EvalCache() { clear(); }
+
+    inline void clear() { entries.fill({0, VALUE_NONE}); }
+
+    inline bool probe(uint64_t hash, Value& eval) const {
+        const Entry& e = entries[hash & (EVAL_CACHE_ENTRIES - 1)];
+        eval = e.eval;
+        return e.key32 == uint32_t(hash >> 32) && e.eval != VALUE_NONE;
+    }
+
+    inline void store(uint64_t hash, Value eval) {
+        entries[hash & (EVAL_CACHE_ENTRIES - 1)] = {uint32_t(hash >> 32), eval};
+    }
+
+private:
+    struct Entry {
+        uint32_t key32;  // Upper half of the hash, the lower bits are the index
+        Value    eval;
+    };
+
+    std::array<Entry, EVAL_CACHE_ENTRIES> entries;
+};
+
 } // namespace Eval
 
 } // namespace Atom
@@ -0,0 +1,112 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "tunables.h"
+#include "types.h"
+
+namespace Atom {
+
+// One history score. Updates use a gravity formula: the closer the score is
+// to HISTORY_MAX, the less a bonus moves it, so that it stays in
+// [-HISTORY_MAX, HISTORY_MAX] and old results fade out as new ones come in.
+class HistoryEntry {
+public:
+    inline operator int() const { return value; }
+
+    inline void update(int bonus) {
+        bonus  = std::clamp(bonus, -Tunables::HISTORY_MAX, Tunables::HISTORY_MAX);
+        value += bonus - value * std::abs(bonus) / Tunables::HISTORY_MAX;
+    }
+
+private:
+    int16_t value = 0;
+};
+
+
+// Butterfly history: how often a quiet move caused a cutoff, by side to move
+// and from / to squares, whatever the position.
+class ButterflyHistory {
+public:
+    inline HistoryEntry&       at(Color c, Move m)       { return table[c][m & 0xFFF]; }
+    inline const HistoryEntry& at(Color c, Move m) const { return table[c][m & 0xFFF]; }
+
+    inline void clear() { table = {}; }
+
+private:
+    std::array<std::array<HistoryEntry, SQUARE_NB * SQUARE_NB>, COLOR_NB> table;
+};
+
+
+// Capture history: how often a capture caused a cutoff, by moving piece,
+// destination square and captured piece type.
+class CaptureHistory {
+public:
+    inline HistoryEntry&       at(Piece pc, Square to, PieceType captured)       { return table[pc][to][captured]; }
+    inline const HistoryEntry& at(Piece pc, Square to, PieceType captured) const { return table[pc][to][captured]; }
+
+    inline void clear() { table = {}; }
+
+private:
+    std::array<std::array<std::array<HistoryEntry, PIECE_TYPE_NB>, SQUARE_NB>, PIECE_NB> table;
+};
+
+
+// Counter moves: the last quiet move that refuted a move, by the piece and
+// destination square of the refuted move.
+class CounterMoveTable {
+public:
+    inline Move& at(Piece pc, Square to)       { return table[pc][to]; }
+    inline Move  at(Piece pc, Square to) const { return table[pc][to]; }
+
+    inline void clear() { table = {}; }
+
+private:
+    static_assert(MOVE_NONE == 0, "A cleared table holds no counter move");
+
+    std::array<std::array<Move, SQUARE_NB>, PIECE_NB> table = {};
+};
+
+
+// History of a quiet move by its moved piece and destination square
+using PieceToHistory = std::array<std::array<HistoryEntry, SQUARE_NB>, PIECE_NB>;
+
+
+// Continuation history: the PieceToHistory of a move, given the piece and
+// destination of a move played one, two or four plies earlier. Each search
+// stack entry points to the table of its move, see StackObject::contHist.
+class ContinuationHistory {
+public:
+    inline PieceToHistory&       at(Piece pc, Square to)       { return table[pc][to]; }
+    inline const PieceToHistory& at(Piece pc, Square to) const { return table[pc][to]; }
+
+    // Table used after a null move, and before the root: never updated
+    inline PieceToHistory* sentinel() { return &table[NO_PIECE][SQ_ZERO]; }
+
+    inline void clear() { table = {}; }
+
+private:
+    std::array<std::array<PieceToHistory, SQUARE_NB>, PIECE_NB> table;
+};
+
+
+// Plies back of the continuation histories used, and their weight in the
+// move ordering
+constexpr int CONT_HIST_PLIES[]  = {1, 2, 4};
+constexpr int CONT_HIST_WEIGHT[] = {2, 1, 1};
+constexpr int CONT_HIST_NB       = 3;
+
+
+// Bonus for a move that caused a cutoff at the given depth, the other moves
+// searched before it get the opposite
+inline int historyBonus(Depth depth) {
+    return std::min(Tunables::HISTORY_BONUS_MULT * depth - Tunables::HISTORY_BONUS_OFFSET, Tunables::HISTORY_BONUS_MAX);
+}
+
+} // namespace Atom
+
+#endif // HISTORY_H
@@ -1,9 +1,11 @@
 #include "bitboard.h"
+#include "nnue/nnue_dispatch.h"
 #include "uci.h"
 #include "zobrist.h"
 #include <cstddef>
 #include <cstdlib>
 #include <ctime>
+#include <iostream>
 
 using namespace Atom;
 
@@ -16,6 +18,11 @@ void initEverything() {
 }
 
 int main (int argc, char *argv[]) {
+    if (!NNUE::cpuSupported()) {
+        std::cerr << "This CPU lacks SSE4.1, POPCNT or BMI2, which the engine needs" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     initEverything();
 
     Uci uci;
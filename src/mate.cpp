@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "mate.h"
+#include "movegen.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+#include "types.h"
+#include "uci.h"
+
+namespace Atom {
+
+namespace Mate {
+
+void MateTable::resize(size_t sizeInMb) {
+    buckets.assign(std::max<size_t>(1, sizeInMb * 1024 * 1024 / sizeof(Bucket)), Bucket());
+}
+
+
+void MateTable::clear() {
+    std::fill(buckets.begin(), buckets.end(), Bucket());
+}
+
+
+void MateTable::probe(uint64_t key, uint32_t& phi, uint32_t& delta) const {
+    const uint32_t key32 = uint32_t(key >> 32);
+
+    for (const MateEntry& e : bucket(key)) {
+        if (e.work && e.key32 == key32) {
+            phi   = e.phi;
+            delta = e.delta;
+            return;
+        }
+    }
+
+    phi = delta = 1;
+}
+
+
+void MateTable::store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work) {
+    const uint32_t key32 = uint32_t(key >> 32);
+    Bucket& b = bucket(key);
+
+    // Overwrite the node itself, or else the entry that took the least work
+    MateEntry* replace = &b[0];
+    for (MateEntry& e : b) {
+        if (e.work && e.key32 == key32) {
+            replace = &e;
+            break;
+        }
+        if (e.work < replace->work) {
+            replace = &e;
+        }
+    }
+
+    *replace = {key32, phi, delta, uint32_t(std::clamp<uint64_t>(work, 1, UINT32_MAX))};
+}
+
+} // namespace Mate
+
+
+namespace Search {
+
+using Mate::PN_INFINITE;
+
+
+// Answers go mate with a proof-number search instead of alpha-beta, which
+// only looks at the moves that matter for the mate and needs no evaluation.
+// The number of moves is raised one at a time, so that the first mate found
+// is the shortest one.
+//
+// Returns true when a mate was found: it is then the first root move, with
+// its line, and has been reported. Otherwise there is no mate in the given
+// number of moves (or the search was stopped) and the caller falls back to
+// the normal search.
+bool SearchWorker::solveMate() {
+    const int maxMoves = std::min(limits.mate, (MAX_PLY - 1) / 2);
+
+    for (int movesLeft = 1; movesLeft <= maxMoves && !threads.shouldStop; ++movesLeft) {
+        rootPosition.getSideToMove() == WHITE
+            ? mateSearch<WHITE, true>(rootPosition, movesLeft, PN_INFINITE, PN_INFINITE, 0)
+            : mateSearch<BLACK, true>(rootPosition, movesLeft, PN_INFINITE, PN_INFINITE, 0);
+
+        uint32_t phi, delta;
+        mateTable.probe(Mate::nodeKey(rootPosition.hash(), movesLeft), phi, delta);
+
+        if (phi != 0) continue;
+
+        MoveList pv;
+        rootPosition.getSideToMove() == WHITE
+            ? matePv<WHITE>(rootPosition, movesLeft, pv)
+            : matePv<BLACK>(rootPosition, movesLeft, pv);
+
+        if (pv.empty()) return false;
+
+        // Put the mating move first, as the search would have
+        auto rm = std::find(rootMoves.begin(), rootMoves.end(), pv[0]);
+        std::rotate(rootMoves.begin(), rm, rm + 1);
+
+        rootMoves[0].score    = rootMoves[0].uciScore = VALUE_MATE - (2 * movesLeft - 1);
+        rootMoves[0].selDepth = pv.size();
+        rootMoves[0].pv       = pv;
+
+        completedDepth = 2 * movesLeft - 1;
+        onNewPv(*this, threads, tt, completedDepth);
+
+        return true;
+    }
+
+    // No mate within reach: the normal search still has to pick a move, but
+    // it can not find a mate either, so do not let it search for one forever
+    if (!threads.shouldStop) {
+        Uci::callbackString("no mate in " + std::to_string(limits.mate));
+        limits.depth = limits.depth ? std::min(limits.depth, 2 * limits.mate) : 2 * limits.mate;
+    }
+
+    return false;
+}
+
+
+// Depth-first proof-number search of one node (Nagai's df-pn). The node is
+// searched until its phi or delta reaches the given threshold, and the
+// numbers it ends with are stored in the mate table, where the parent reads
+// them back.
+//
+// Attacker nodes are those where the side looking for the mate is to move.
+// movesLeft is the number of attacker moves that are still allowed.
+template<Color Me, bool Attacker>
+void SearchWorker::mateSearch(Position& pos, int movesLeft, uint32_t thPhi, uint32_t thDelta, int ply) {
+    const uint64_t key        = Mate::nodeKey(pos.hash(), movesLeft);
+    const uint64_t nodesStart = counters.nodes;
+
+    // Numbers of a node that the side to move has won, or lost
+    constexpr uint32_t WON[]  = {0, PN_INFINITE};
+    constexpr uint32_t LOST[] = {PN_INFINITE, 0};
+
+    auto storeResult = [&](const uint32_t* result) {
+        mateTable.store(key, result[0], result[1], counters.nodes - nodesStart);
+    };
+
+    countNode();
+
+    // A draw is a failure for the attacker. Draws by repetition depend on the
+    // path, so storing them can only hide mates, never make a wrong one.
+    if (pos.isDraw() || ply >= MAX_PLY - 1) {
+        storeResult(Attacker ? LOST : WON);
+        return;
+    }
+
+    // The attacker has played all its moves: the defender must be mated now
+    if (!Attacker && movesLeft == 0) {
+        const bool canMove = !Movegen::enumerateLegalMoves<Me>(pos, [](Move) { return false; });
+        storeResult(canMove ? WON : pos.inCheck() ? LOST : WON);
+        return;
+    }
+
+    // The last attacker move has to mate, so it has to be a check
+    Move moves[MAX_MOVE];
+    Move* const end = Attacker && movesLeft == 1 ? Movegen::enumerateChecksToList<Me>(pos, moves)
+                                                 : Movegen::enumerateLegalMovesToList<Me>(pos, moves);
+    const int nMoves = end - moves;
+
+    if (nMoves == 0) {
+        // Checkmate, stalemate, or an attacker without any check left
+        storeResult(!Attacker && !pos.inCheck() ? WON : LOST);
+        return;
+    }
+
+    // Try checks first: they leave the defender the fewest replies
+    if constexpr (Attacker) {
+        std::partition(moves, end, [&](Move m) { return pos.givesCheck<Me>(m); });
+    }
+
+    const int childMovesLeft = Attacker ? movesLeft - 1 : movesLeft;
+
+    uint64_t childKeys[MAX_MOVE];
+    for (int i = 0; i < nMoves; ++i) {
+        pos.doMove<Me>(moves[i]);
+        childKeys[i] = Mate::nodeKey(pos.hash(), childMovesLeft);
+        pos.undoMove<Me>(moves[i]);
+    }
+
+    while (true) {
+        uint32_t phi = PN_INFINITE, secondPhi = PN_INFINITE, bestChildPhi = 0;
+        uint64_t delta = 0;
+        int best = 0;
+
+        for (int i = 0; i < nMoves; ++i) {
+            uint32_t childPhi, childDelta;
+            mateTable.probe(childKeys[i], childPhi, childDelta);
+
+            delta += childPhi;
+
+            if (childDelta < phi) {
+                secondPhi    = phi;
+                phi          = childDelta;
+                bestChildPhi = childPhi;
+                best         = i;
+            } else if (childDelta < secondPhi) {
+                secondPhi = childDelta;
+            }
+        }
+
+        delta = std::min<uint64_t>(delta, PN_INFINITE);
+
+        if (phi >= thPhi || delta >= thDelta || threads.shouldStop.load(std::memory_order_relaxed)) {
+            mateTable.store(key, phi, uint32_t(delta), counters.nodes - nodesStart);
+            return;
+        }
+
+        // Search the most promising child until it stops being the most
+        // promising one, or until this node reaches one of its thresholds
+        const uint32_t childThPhi   = uint32_t(std::min<uint64_t>(thDelta - delta + bestChildPhi, PN_INFINITE));
+        const uint32_t childThDelta = std::min(thPhi, secondPhi + 1);
+
+        pos.doMove<Me>(moves[best]);
+        mateSearch<~Me, !Attacker>(pos, childMovesLeft, childThPhi, childThDelta, ply + 1);
+        pos.undoMove<Me>(moves[best]);
+    }
+}
+
+
+// Follows a proven mate from the table: any move that keeps the proof for the
+// attacker, and any reply for the defender, as they all lose. Stops early if
+// the table has lost part of the proof.
+template<Color Me>
+void SearchWorker::matePv(Position& pos, int movesLeft, MoveList& pv) {
+    const bool attacker = pv.size() % 2 == 0;
+
+    Move moves[MAX_MOVE];
+    Move* const end = Movegen::enumerateLegalMovesToList<Me>(pos, moves);
+
+    const int childMovesLeft = attacker ? movesLeft - 1 : movesLeft;
+
+    for (Move* m = moves; m != end; ++m) {
+        pos.doMove<Me>(*m);
+
+        uint32_t phi, delta;
+        mateTable.probe(Mate::nodeKey(pos.hash(), childMovesLeft), phi, delta);
+
+        // The child must be lost for its side to move if we attack, and won if we defend
+        if (attacker ? delta == 0 : phi == 0) {
+            pv.push_back(*m);
+            matePv<~Me>(pos, childMovesLeft, pv);
+            pos.undoMove<Me>(*m);
+            return;
+        }
+
+        pos.undoMove<Me>(*m);
+    }
+}
+
+} // namespace Search
+
+} // namespace Atom
@@ -0,0 +1,75 @@
+#ifndef MATE_H
+#define MATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+namespace Atom {
+
+namespace Mate {
+
+// Proof-number search, used by go mate (see SearchWorker::solveMate).
+//
+// Every node has a proof and a disproof number: the least number of leaves
+// that must still be solved to show that the side to move wins, or loses.
+// They are kept from the side to move's point of view, as phi and delta:
+// - at the nodes where the attacker moves, phi is the proof number,
+// - at the nodes where the defender moves, phi is the disproof number.
+// A node is won for the side to move at phi = 0, and lost at delta = 0.
+// With this convention, the phi of a node is the smallest delta of its
+// children, and its delta the sum of the children's phis.
+
+constexpr size_t   MATE_HASH_DEFAULT_SIZE = 16;       // MB
+constexpr uint32_t PN_INFINITE            = 1 << 30;
+
+
+// Key of a node: the position, and the number of attacker moves left to
+// mate in, as a position can be won with some moves left and not with fewer.
+inline uint64_t nodeKey(uint64_t hash, int movesLeft) {
+    return hash ^ (uint64_t(movesLeft) * 0x9E3779B97F4A7C15ULL);
+}
+
+
+struct MateEntry {
+    uint32_t key32;       // Upper half of the node key
+    uint32_t phi, delta;
+    uint32_t work;        // Nodes spent on the node, zero for an empty entry
+};
+
+
+// Table of the proof and disproof numbers found so far. Unlike the main
+// transposition table, entries are replaced by the amount of work they
+// saved rather than by depth.
+class MateTable {
+public:
+    static constexpr int ENTRIES_PER_BUCKET = 4;
+
+    MateTable(size_t sizeInMb = MATE_HASH_DEFAULT_SIZE) { resize(sizeInMb); }
+
+    void resize(size_t sizeInMb);
+    void clear();
+
+    inline size_t sizeInMb() const { return buckets.size() * sizeof(Bucket) / (1024 * 1024); }
+
+    // Nodes that were never searched, or have been replaced, are worth (1, 1)
+    void probe(uint64_t key, uint32_t& phi, uint32_t& delta) const;
+    void store(uint64_t key, uint32_t phi, uint32_t delta, uint64_t work);
+
+private:
+    using Bucket = std::array<MateEntry, ENTRIES_PER_BUCKET>;
+
+    inline const Bucket& bucket(uint64_t key) const { return buckets[uint32_t(key) % buckets.size()]; }
+    inline Bucket&       bucket(uint64_t key)       { return buckets[uint32_t(key) % buckets.size()]; }
+
+    std::vector<Bucket> buckets;
+};
+
+} // namespace Mate
+
+} // namespace Atom
+
+#endif // MATE_H
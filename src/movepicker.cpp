@@ -53,16 +53,25 @@ void MovePicker<Me>::score() {
                             | (pos.getPiecesBB(Me, QUEEN) & enemyRookThreats);
     }
 
-    for (ScoredMove& sm : movelist) {
+    for (ScoredMove* it = current; it < endMoves; ++it) {
+        ScoredMove& sm = *it;
+
         // Quiet moves
         if constexpr (MgType == Movegen::MG_TYPE_QUIET) {
             const Square from  = moveFrom(sm.move);
             const Square to    = moveTo(sm.move);
-            const PieceType pt = typeOf(pos.getPieceAt(from));
+            const Piece  pc    = pos.getPieceAt(from);
+            const PieceType pt = typeOf(pc);
 
             // Killer move bonus
             sm.score =  (sm.move == killer) * Tunables::MOVEPICK_KILLER_SCORE;
 
+            // History of the move, on its own and following the previous moves
+            sm.score += Tunables::MOVEPICK_MAIN_HISTORY_WEIGHT * mainHistory.at(Me, sm.move);
+            for (int i = 0; i < CONT_HIST_NB; ++i) {
+                sm.score += CONT_HIST_WEIGHT[i] * (*contHist[i])[pc][to];
+            }
+
             // Check bonus
         sm.score += (pos.givesCheck<Me>(sm.move)) * Tunables::MOVEPICK_CHECK_SCORE;
 
@@ -84,7 +93,13 @@ void MovePicker<Me>::score() {
 
         // Tactical moves
         else if constexpr (MgType == Movegen::MG_TYPE_TACTICAL) {
-            sm.score = Tunables::MOVEPICK_CAPTURE_MULTIPLIER * PIECE_VALUE[pos.getPieceAt(moveTo(sm.move))];
+            const Square to       = moveTo(sm.move);
+            const Piece  captured = pos.getPieceAt(to);
+
+            // Victim value, corrected by how well this capture did so far. The
+            // score also sets the SEE threshold of good captures.
+            sm.score = Tunables::MOVEPICK_CAPTURE_MULTIPLIER * PIECE_VALUE[captured]
+                     + captureHistory.at(pos.getPieceAt(moveFrom(sm.move)), to, typeOf(captured)) / Tunables::MOVEPICK_CAPTURE_HISTORY_DIV;
         }
 
         // Evasions
@@ -141,12 +156,14 @@ top:
         case MovePickStage::MP_STAGE_TT:
         case MovePickStage::MP_STAGE_EVASION_TT:
         case MovePickStage::MP_STAGE_QSEARCH_ALL_TT:
+        case MovePickStage::MP_STAGE_PROBCUT_TT:
             ++mpStage;
             return ttMove;
 
         // Generate all moves for stage
         case MovePickStage::MP_STAGE_CAPTURE_GENERATE:
         case MovePickStage::MP_STAGE_QSEARCH_CAP_GENERATE:
+        case MovePickStage::MP_STAGE_PROBCUT_GENERATE:
             current  = endBadCaptures = movelist;
             endMoves = Movegen::enumerateLegalMovesToList<Me, Movegen::MG_TYPE_TACTICAL>(pos, current);
 
@@ -174,6 +191,14 @@ top:
             ++mpStage;
             [[fallthrough]];
 
+        // Counter move to the opponent's last move
+        case MovePickStage::MP_STAGE_COUNTER:
+            ++mpStage;
+            if (!skipQuiet && isCounterMove()) {
+                return counterMove;
+            }
+            [[fallthrough]];
+
         // Generate the quiet moves
         case MovePickStage::MP_STAGE_QUIET_GENERATE:
             if (!skipQuiet) {
@@ -189,7 +214,7 @@ top:
         // Find good quiet moves
         case MovePickStage::MP_STAGE_QUIET_GOOD:
             // Return next move if it isn't in the TT
-            if (!skipQuiet && MovePicker<Me>::select<MP_TYPE_NEXT>([]() { return true; })) {
+            if (!skipQuiet && MovePicker<Me>::select<MP_TYPE_NEXT>([&]() { return current->move != counterMove; })) {
 
                 // Check to see if we still have good quiet moves
                 if (
@@ -225,7 +250,7 @@ top:
         case MovePickStage::MP_STAGE_QUIET_BAD:
             if (!skipQuiet) {
                 // Return next move if it isn't in the TT
-                return MovePicker<Me>::select<MP_TYPE_NEXT>([]() { return true; }).move;
+                return MovePicker<Me>::select<MP_TYPE_NEXT>([&]() { return current->move != counterMove; }).move;
             }
 
             // If we aren't in evasions or qsearch, the search ends here:
@@ -267,6 +292,10 @@ top:
             // Return next move if it isn't in the TT
             return MovePicker<Me>::select<MP_TYPE_NEXT>([]() { return true; }).move;
 
+        case MovePickStage::MP_STAGE_PROBCUT_GOOD:
+            // Return next move if it isn't in the TT, and wins enough material
+            return MovePicker<Me>::select<MP_TYPE_NEXT>([&]() { return pos.see(current->move, threshold); }).move;
+
     }
 
     // Should never reach this point.
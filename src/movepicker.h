@@ -1,8 +1,10 @@
 #ifndef MOVEPICKER_H
 #define MOVEPICKER_H
 
+#include <cassert>
 #include <cstdint>
 
+#include "history.h"
 #include "position.h"
 #include "movegen.h"
 #include "types.h"
@@ -18,6 +20,8 @@ enum class MovePickStage : uint32_t {
     MP_STAGE_CAPTURE_GENERATE,
     MP_STAGE_CAPTURE_GOOD,
 
+    MP_STAGE_COUNTER,
+
     MP_STAGE_QUIET_GENERATE,
     MP_STAGE_QUIET_GOOD,
 
@@ -33,6 +37,10 @@ enum class MovePickStage : uint32_t {
     MP_STAGE_QSEARCH_CAP_GOOD,
     MP_STAGE_QSEARCH_CHK_GENERATE,
     MP_STAGE_QSEARCH_CHK_GOOD,
+
+    MP_STAGE_PROBCUT_TT,
+    MP_STAGE_PROBCUT_GENERATE,
+    MP_STAGE_PROBCUT_GOOD,
 };
 
 
@@ -78,12 +86,35 @@ public:
         const Position& pos,
         Move  ttMove,
         Move  killer,
-        Depth depth
-    ) : pos(pos), ttMove(ttMove), killer(killer), depth(depth)
+        Move  counterMove,
+        Depth depth,
+        const ButterflyHistory& mainHistory,
+        const CaptureHistory&   captureHistory,
+        const PieceToHistory* const* contHist,
+        ScoredMove* movelist
+    ) : pos(pos), ttMove(ttMove), killer(killer), counterMove(counterMove), depth(depth),
+        mainHistory(mainHistory), captureHistory(captureHistory), contHist(contHist), movelist(movelist)
     {
         mpStage = determineStage(pos.inCheck(), ttMove, depth);
     }
 
+    // ProbCut: only the captures that win at least threshold in SEE
+    MovePicker(
+        const Position& pos,
+        Move  ttMove,
+        int   threshold,
+        const ButterflyHistory& mainHistory,
+        const CaptureHistory&   captureHistory,
+        ScoredMove* movelist
+    ) : pos(pos), ttMove(ttMove), killer(MOVE_NONE), counterMove(MOVE_NONE), depth(0), threshold(threshold),
+        mainHistory(mainHistory), captureHistory(captureHistory), contHist(nullptr), movelist(movelist)
+    {
+        assert(!pos.inCheck());
+
+        mpStage = MovePickStage::MP_STAGE_PROBCUT_TT
+                + !(ttMove && !pos.isEmpty(moveTo(ttMove)) && pos.isPseudoLegalMove<Me>(ttMove) && pos.see(ttMove, threshold));
+    }
+
     // MovePicker cannot be copied
     MovePicker(const MovePicker &)            = delete;
     MovePicker(MovePicker &&)                 = delete;
@@ -94,10 +125,14 @@ public:
 
 private:
     const Position& pos;
-    Move            ttMove, killer;
+    Move            ttMove, killer, counterMove;
     Depth           depth;
+    int             threshold = 0;  // SEE threshold of the ProbCut captures
+    const ButterflyHistory&      mainHistory;
+    const CaptureHistory&        captureHistory;
+    const PieceToHistory* const* contHist;  // CONT_HIST_NB tables, see CONT_HIST_PLIES
     MovePickStage   mpStage;
-    ScoredMove      movelist[MAX_MOVE];
+    ScoredMove*     movelist;  // MAX_MOVE entries, owned by the caller (see SearchWorker::moveLists)
     ScoredMove      *current, *endMoves, *endBadCaptures, *beginBadQuiets, *endBadQuiets;
 
     inline MovePickStage determineStage(const bool inCheck, Move ttMove, Depth depth) const {
@@ -108,6 +143,13 @@ private:
         }
     }
 
+    // The counter move is returned before the other quiets, if it is still
+    // quiet and legal here
+    inline bool isCounterMove() const {
+        return counterMove != MOVE_NONE && counterMove != ttMove
+            && pos.isEmpty(moveTo(counterMove)) && pos.isPseudoLegalMove<Me>(counterMove);
+    }
+
     template<Movegen::MoveGenType MgType>
     void score();
 
@@ -161,6 +161,7 @@ class AffineTransform {
              + i / PaddedInputDimensions * 4 + i % 4;
     }
 
+    template<Isa I>
     static constexpr IndexType get_weight_index(IndexType i) {
 #if defined(USE_SSSE3)
         return get_weight_index_scrambled(i);
@@ -170,24 +171,27 @@ class AffineTransform {
     }
 
     // Read network parameters
+    template<Isa I>
     bool read_parameters(std::istream& stream) {
         read_little_endian<BiasType>(stream, biases, OutputDimensions);
         for (IndexType i = 0; i < OutputDimensions * PaddedInputDimensions; ++i)
-            weights[get_weight_index(i)] = read_little_endian<WeightType>(stream);
+            weights[get_weight_index<I>(i)] = read_little_endian<WeightType>(stream);
 
         return !stream.fail();
     }
 
     // Write network parameters
+    template<Isa I>
     bool write_parameters(std::ostream& stream) const {
         write_little_endian<BiasType>(stream, biases, OutputDimensions);
 
         for (IndexType i = 0; i < OutputDimensions * PaddedInputDimensions; ++i)
-            write_little_endian<WeightType>(stream, weights[get_weight_index(i)]);
+            write_little_endian<WeightType>(stream, weights[get_weight_index<I>(i)]);
 
         return !stream.fail();
     }
     // Forward propagation
+    template<Isa I>
     void propagate(const InputType* input, OutputType* output) const {
 
 #if defined(USE_SSSE3)
@@ -44,14 +44,14 @@ alignas(CacheLineSize) static inline const
       for (unsigned i = 0; i < 256; ++i)
       {
           std::uint64_t j = i, k = 0;
-          while (j)
-              v[i][k++] = pop_lsb(j);
+          for (; j; j &= j - 1)
+              v[i][k++] = bitscan(j);
       }
       return v;
   }();
 
 // Find indices of nonzero numbers in an int32_t array
-template<const IndexType InputDimensions>
+template<Isa I, const IndexType InputDimensions>
 void find_nnz(const std::int32_t* input, std::uint16_t* out, IndexType& count_out) {
     #if defined(USE_SSSE3)
         #if defined(USE_AVX512)
@@ -170,6 +170,7 @@ class AffineTransformSparseInput {
              + i / PaddedInputDimensions * ChunkSize + i % ChunkSize;
     }
 
+    template<Isa I>
     static constexpr IndexType get_weight_index(IndexType i) {
 #if (USE_SSSE3 | (USE_NEON >= 8))
         return get_weight_index_scrambled(i);
@@ -179,24 +180,27 @@ class AffineTransformSparseInput {
     }
 
     // Read network parameters
+    template<Isa I>
     bool read_parameters(std::istream& stream) {
         read_little_endian<BiasType>(stream, biases, OutputDimensions);
         for (IndexType i = 0; i < OutputDimensions * PaddedInputDimensions; ++i)
-            weights[get_weight_index(i)] = read_little_endian<WeightType>(stream);
+            weights[get_weight_index<I>(i)] = read_little_endian<WeightType>(stream);
 
         return !stream.fail();
     }
 
     // Write network parameters
+    template<Isa I>
     bool write_parameters(std::ostream& stream) const {
         write_little_endian<BiasType>(stream, biases, OutputDimensions);
 
         for (IndexType i = 0; i < OutputDimensions * PaddedInputDimensions; ++i)
-            write_little_endian<WeightType>(stream, weights[get_weight_index(i)]);
+            write_little_endian<WeightType>(stream, weights[get_weight_index<I>(i)]);
 
         return !stream.fail();
     }
     // Forward propagation
+    template<Isa I>
     void propagate(const InputType* input, OutputType* output) const {
 
 #if (USE_SSSE3 | (USE_NEON >= 8))
@@ -236,7 +240,7 @@ class AffineTransformSparseInput {
         const auto input32 = reinterpret_cast<const std::int32_t*>(input);
 
         // Find indices of nonzero 32-bit blocks
-        find_nnz<NumChunks>(input32, nnz, count);
+        find_nnz<I, NumChunks>(input32, nnz, count);
 
         const outvec_t* biasvec = reinterpret_cast<const outvec_t*>(biases);
         outvec_t        acc[NumRegs];
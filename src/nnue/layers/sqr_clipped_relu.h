@@ -59,6 +59,7 @@ public:
     bool write_parameters(std::ostream&) const { return true; }
 
     // Forward propagation
+    template<Isa I>
     void propagate(const InputType* input, OutputType* output) const {
 
 #if defined(USE_SSE2)
@@ -33,6 +33,7 @@
 #include "../types.h"
 #include "nnue_architecture.h"
 #include "nnue_common.h"
+#include "nnue_dispatch.h"
 #include "nnue_misc.h"
 
 namespace {
@@ -82,29 +83,6 @@ EmbeddedNNUE get_embedded(EmbeddedNNUEType type) {
 namespace Atom::NNUE {
 
 
-namespace Detail {
-
-// Read evaluation function parameters
-template<typename T>
-bool read_parameters(std::istream& stream, T& reference) {
-
-    std::uint32_t header;
-    header = read_little_endian<std::uint32_t>(stream);
-    if (!stream || header != T::get_hash_value())
-        return false;
-    return reference.read_parameters(stream);
-}
-
-// Write evaluation function parameters
-template<typename T>
-bool write_parameters(std::ostream& stream, const T& reference) {
-
-    write_little_endian<std::uint32_t>(stream, T::get_hash_value());
-    return reference.write_parameters(stream);
-}
-
-}  // namespace Detail
-
 template<typename Arch, typename Transformer>
 Network<Arch, Transformer>::Network(const Network<Arch, Transformer>& other) :
     evalFile(other.evalFile),
@@ -207,28 +185,9 @@ template<typename Arch, typename Transformer>
 NetworkOutput
 Network<Arch, Transformer>::evaluate(const Position&                         pos,
                                      AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    // We manually align the arrays on the stack because with gcc < 9.3
-    // overaligning stack variables with alignas() doesn't work correctly.
-
-    constexpr uint64_t alignment = CacheLineSize;
-
-#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
-    TransformedFeatureType
-    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
-    + alignment / sizeof(TransformedFeatureType)];
-
-    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
-#else
-    alignas(alignment) TransformedFeatureType
-    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
-#endif
-
-    ASSERT_ALIGNED(transformedFeatures, alignment);
-
-    const int  bucket     = (pos.nPieces() - 1) / 4;
-    const auto psqt       = featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-    const auto positional = network[bucket].propagate(transformedFeatures);
-    return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
+    return withActiveIsa([&](auto isa) {
+        return this->template evaluate_for<decltype(isa)::value>(pos, cache);
+    });
 }
 
 
@@ -261,50 +220,25 @@ void Network<Arch, Transformer>::verify(std::string evalfilePath) const {
     std::cout << "info string NNUE evaluation using " << evalfilePath << " ("
         << size / (1024 * 1024) << "MiB, (" << featureTransformer->InputDimensions << ", "
         << network[0].TransformedFeatureDimensions << ", " << network[0].FC_0_OUTPUTS << ", "
-        << network[0].FC_1_OUTPUTS << ", 1))" << std::endl;
+        << network[0].FC_1_OUTPUTS << ", 1), " << isaName(activeIsa()) << " kernels)" << std::endl;
 }
 
 
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::hint_common_access(
     const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    featureTransformer->hint_common_access(pos, cache);
+    withActiveIsa([&](auto isa) {
+        this->template hint_common_access_for<decltype(isa)::value>(pos, cache);
+    });
 }
 
 template<typename Arch, typename Transformer>
 NnueEvalTrace
 Network<Arch, Transformer>::trace_evaluate(const Position&                         pos,
                                            AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    // We manually align the arrays on the stack because with gcc < 9.3
-    // overaligning stack variables with alignas() doesn't work correctly.
-    constexpr uint64_t alignment = CacheLineSize;
-
-#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
-    TransformedFeatureType
-    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
-    + alignment / sizeof(TransformedFeatureType)];
-
-    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
-#else
-    alignas(alignment) TransformedFeatureType
-    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
-#endif
-
-    ASSERT_ALIGNED(transformedFeatures, alignment);
-
-    NnueEvalTrace t{};
-    t.correctBucket = (pos.nPieces() - 1) / 4;
-    for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
-    {
-        const auto materialist =
-            featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-        const auto positional = network[bucket].propagate(transformedFeatures);
-
-        t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
-        t.positional[bucket] = static_cast<Value>(positional / OutputScale);
-    }
-
-    return t;
+    return withActiveIsa([&](auto isa) {
+        return this->template trace_evaluate_for<decltype(isa)::value>(pos, cache);
+    });
 }
 
 
@@ -415,14 +349,11 @@ bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
         return false;
     if (hashValue != Network::hash)
         return false;
-    if (!Detail::read_parameters(stream, *featureTransformer))
-        return false;
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-    {
-        if (!Detail::read_parameters(stream, network[i]))
-            return false;
-    }
-    return stream && stream.peek() == std::ios::traits_type::eof();
+
+    // The weights are stored in the order the kernels read them
+    return withActiveIsa([&](auto isa) {
+        return this->template read_parameters_for<decltype(isa)::value>(stream);
+    });
 }
 
 
@@ -431,14 +362,10 @@ bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
                                                   const std::string& netDescription) const {
     if (!write_header(stream, Network::hash, netDescription))
         return false;
-    if (!Detail::write_parameters(stream, *featureTransformer))
-        return false;
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-    {
-        if (!Detail::write_parameters(stream, network[i]))
-            return false;
-    }
-    return bool(stream);
+
+    return withActiveIsa([&](auto isa) {
+        return this->template write_parameters_for<decltype(isa)::value>(stream);
+    });
 }
 
 // Explicit template instantiation
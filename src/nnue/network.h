@@ -31,6 +31,7 @@
 #include "../types.h"
 #include "nnue_accumulator.h"
 #include "nnue_architecture.h"
+#include "nnue_dispatch.h"
 #include "nnue_feature_transformer.h"
 #include "nnue_misc.h"
 
@@ -87,6 +88,23 @@ private:
     bool read_parameters(std::istream&, std::string&) const;
     bool write_parameters(std::ostream&, const std::string&) const;
 
+    // What the functions above do for a given instruction set. They are
+    // defined in network_kernels.cpp, which is compiled once for each
+    // instruction set, and called for activeIsa() (see nnue_dispatch.h).
+    template<Isa I>
+    NetworkOutput evaluate_for(const Position&                         pos,
+                               AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    template<Isa I>
+    void hint_common_access_for(const Position&                         pos,
+                                AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    template<Isa I>
+    NnueEvalTrace trace_evaluate_for(const Position&                         pos,
+                                     AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    template<Isa I>
+    bool read_parameters_for(std::istream&) const;
+    template<Isa I>
+    bool write_parameters_for(std::ostream&) const;
+
     // Input feature converter
     LargePagePtr<Transformer> featureTransformer;
 
@@ -0,0 +1,191 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2024 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The parts of Network that run the NNUE kernels. This unit is compiled for
+// the instruction set of the build, or once per instruction set in a fat
+// binary (see nnue_dispatch.h), and instantiates them for that one only.
+
+#include <cstdint>
+#include <iostream>
+
+#include "../position.h"
+#include "../types.h"
+#include "network.h"
+#include "nnue_architecture.h"
+#include "nnue_common.h"
+#include "nnue_dispatch.h"
+#include "nnue_feature_transformer.h"
+#include "nnue_misc.h"
+
+namespace Atom::NNUE {
+
+namespace Detail {
+
+// Read evaluation function parameters
+template<Isa I, typename T>
+bool read_parameters(std::istream& stream, T& reference) {
+
+    std::uint32_t header;
+    header = read_little_endian<std::uint32_t>(stream);
+    if (!stream || header != T::get_hash_value())
+        return false;
+    return reference.template read_parameters<I>(stream);
+}
+
+// Write evaluation function parameters
+template<Isa I, typename T>
+bool write_parameters(std::ostream& stream, const T& reference) {
+
+    write_little_endian<std::uint32_t>(stream, T::get_hash_value());
+    return reference.template write_parameters<I>(stream);
+}
+
+}  // namespace Detail
+
+
+template<typename Arch, typename Transformer>
+template<Isa I>
+NetworkOutput
+Network<Arch, Transformer>::evaluate_for(const Position&                         pos,
+                                         AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    static_assert(I == CompiledIsa);
+
+    // We manually align the arrays on the stack because with gcc < 9.3
+    // overaligning stack variables with alignas() doesn't work correctly.
+
+    constexpr uint64_t alignment = CacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
+    + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType
+    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    const int  bucket     = (pos.nPieces() - 1) / 4;
+    const auto psqt       = featureTransformer->template transform<I>(pos, cache, transformedFeatures, bucket);
+    const auto positional = network[bucket].template propagate<I>(transformedFeatures);
+    return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
+}
+
+
+template<typename Arch, typename Transformer>
+template<Isa I>
+void Network<Arch, Transformer>::hint_common_access_for(
+    const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    static_assert(I == CompiledIsa);
+
+    featureTransformer->template hint_common_access<I>(pos, cache);
+}
+
+
+template<typename Arch, typename Transformer>
+template<Isa I>
+NnueEvalTrace
+Network<Arch, Transformer>::trace_evaluate_for(const Position&                         pos,
+                                               AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    static_assert(I == CompiledIsa);
+
+    // We manually align the arrays on the stack because with gcc < 9.3
+    // overaligning stack variables with alignas() doesn't work correctly.
+    constexpr uint64_t alignment = CacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
+    + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType
+    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    NnueEvalTrace t{};
+    t.correctBucket = (pos.nPieces() - 1) / 4;
+    for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
+    {
+        const auto materialist =
+            featureTransformer->template transform<I>(pos, cache, transformedFeatures, bucket);
+        const auto positional = network[bucket].template propagate<I>(transformedFeatures);
+
+        t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
+        t.positional[bucket] = static_cast<Value>(positional / OutputScale);
+    }
+
+    return t;
+}
+
+
+template<typename Arch, typename Transformer>
+template<Isa I>
+bool Network<Arch, Transformer>::read_parameters_for(std::istream& stream) const {
+    static_assert(I == CompiledIsa);
+
+    if (!Detail::read_parameters<I>(stream, *featureTransformer))
+        return false;
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+    {
+        if (!Detail::read_parameters<I>(stream, network[i]))
+            return false;
+    }
+    return stream && stream.peek() == std::ios::traits_type::eof();
+}
+
+
+template<typename Arch, typename Transformer>
+template<Isa I>
+bool Network<Arch, Transformer>::write_parameters_for(std::ostream& stream) const {
+    static_assert(I == CompiledIsa);
+
+    if (!Detail::write_parameters<I>(stream, *featureTransformer))
+        return false;
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+    {
+        if (!Detail::write_parameters<I>(stream, network[i]))
+            return false;
+    }
+    return bool(stream);
+}
+
+// Explicit template instantiation, for the instruction set of this unit
+
+#define INSTANTIATE_KERNELS(Net) \
+    template NetworkOutput Net::evaluate_for<CompiledIsa>(const Position&, \
+        AccumulatorCaches::Cache<Net::FTDimensions>*) const; \
+    template void Net::hint_common_access_for<CompiledIsa>(const Position&, \
+        AccumulatorCaches::Cache<Net::FTDimensions>*) const; \
+    template NnueEvalTrace Net::trace_evaluate_for<CompiledIsa>(const Position&, \
+        AccumulatorCaches::Cache<Net::FTDimensions>*) const; \
+    template bool Net::read_parameters_for<CompiledIsa>(std::istream&) const; \
+    template bool Net::write_parameters_for<CompiledIsa>(std::ostream&) const;
+
+INSTANTIATE_KERNELS(NetworkBig)
+INSTANTIATE_KERNELS(NetworkSmall)
+
+#undef INSTANTIATE_KERNELS
+
+}  // namespace Atom::NNUE
@@ -78,19 +78,22 @@ struct NetworkArchitecture {
     }
 
     // Read network parameters
+    template<Isa I>
     bool read_parameters(std::istream& stream) {
-        return fc_0.read_parameters(stream) && ac_0.read_parameters(stream)
-            && fc_1.read_parameters(stream) && ac_1.read_parameters(stream)
-            && fc_2.read_parameters(stream);
+        return fc_0.template read_parameters<I>(stream) && ac_0.read_parameters(stream)
+            && fc_1.template read_parameters<I>(stream) && ac_1.read_parameters(stream)
+            && fc_2.template read_parameters<I>(stream);
     }
 
     // Write network parameters
+    template<Isa I>
     bool write_parameters(std::ostream& stream) const {
-        return fc_0.write_parameters(stream) && ac_0.write_parameters(stream)
-            && fc_1.write_parameters(stream) && ac_1.write_parameters(stream)
-            && fc_2.write_parameters(stream);
+        return fc_0.template write_parameters<I>(stream) && ac_0.write_parameters(stream)
+            && fc_1.template write_parameters<I>(stream) && ac_1.write_parameters(stream)
+            && fc_2.template write_parameters<I>(stream);
     }
 
+    template<Isa I>
     std::int32_t propagate(const TransformedFeatureType* transformedFeatures) {
         struct alignas(CacheLineSize) Buffer {
             alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
@@ -113,14 +116,14 @@ struct NetworkArchitecture {
         alignas(CacheLineSize) static thread_local Buffer buffer;
 #endif
 
-        fc_0.propagate(transformedFeatures, buffer.fc_0_out);
-        ac_sqr_0.propagate(buffer.fc_0_out, buffer.ac_sqr_0_out);
-        ac_0.propagate(buffer.fc_0_out, buffer.ac_0_out);
+        fc_0.template propagate<I>(transformedFeatures, buffer.fc_0_out);
+        ac_sqr_0.template propagate<I>(buffer.fc_0_out, buffer.ac_sqr_0_out);
+        ac_0.template propagate<I>(buffer.fc_0_out, buffer.ac_0_out);
         std::memcpy(buffer.ac_sqr_0_out + FC_0_OUTPUTS, buffer.ac_0_out,
                     FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
-        fc_1.propagate(buffer.ac_sqr_0_out, buffer.fc_1_out);
-        ac_1.propagate(buffer.fc_1_out, buffer.ac_1_out);
-        fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
+        fc_1.template propagate<I>(buffer.ac_sqr_0_out, buffer.fc_1_out);
+        ac_1.template propagate<I>(buffer.fc_1_out, buffer.ac_1_out);
+        fc_2.template propagate<I>(buffer.ac_1_out, buffer.fc_2_out);
 
         // buffer.fc_0_out[FC_0_OUTPUTS] is such that 1.0 is equal to 127*(1<<WeightScaleBits) in
         // quantized form, but we want 1.0 to be equal to 600*OutputScale
@@ -28,6 +28,8 @@
 #include <iostream>
 #include <type_traits>
 
+#include "nnue_dispatch.h"
+
 #if defined(USE_AVX2)
     #include <immintrin.h>
 
@@ -67,6 +69,9 @@ static inline const union {
 } Le                                    = {0x01020304};
 static inline const bool IsLittleEndian = (Le.c[0] == 4);
 
+// True if and only if the binary is compiled for a 64-bit target
+constexpr bool Is64Bit = sizeof(void*) == 8;
+
 // SIMD width (in bytes)
 #if defined(USE_AVX2)
 constexpr std::size_t SimdWidth = 32;
@@ -0,0 +1,70 @@
+#include "nnue_dispatch.h"
+
+namespace Atom::NNUE {
+
+namespace {
+
+#if defined(FAT_BINARY)
+Isa detectIsa() {
+    __builtin_cpu_init();
+
+    const bool avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+                     && __builtin_cpu_supports("avx512dq");
+
+    if (avx512 && __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl"))
+        return Isa::VNNI512;
+    if (avx512)
+        return Isa::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+        return Isa::BMI2;
+
+    return Isa::SSE41;
+}
+#endif
+
+}  // namespace
+
+
+Isa activeIsa() {
+#if defined(FAT_BINARY)
+    static const Isa isa = detectIsa();
+    return isa;
+#else
+    return CompiledIsa;
+#endif
+}
+
+
+const char* isaName(Isa isa) {
+    switch (isa)
+    {
+    case Isa::SSE2 :
+        return "sse2";
+    case Isa::SSE41 :
+        return "sse41";
+    case Isa::AVX2 :
+        return "avx2";
+    case Isa::BMI2 :
+        return "bmi2";
+    case Isa::AVX512 :
+        return "avx512";
+    case Isa::VNNI512 :
+        return "vnni512";
+    default :
+        return "generic";
+    }
+}
+
+
+bool cpuSupported() {
+#if defined(FAT_BINARY)
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")
+        && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+#else
+    return true;
+#endif
+}
+
+}  // namespace Atom::NNUE
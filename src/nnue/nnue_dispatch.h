@@ -0,0 +1,81 @@
+// Choice of the NNUE kernels for the CPU the engine runs on
+
+#ifndef NNUE_DISPATCH_H_INCLUDED
+#define NNUE_DISPATCH_H_INCLUDED
+
+#include <type_traits>
+
+namespace Atom::NNUE {
+
+// Instruction sets the NNUE kernels can be compiled for.
+//
+// The NNUE code whose body depends on the USE_* macros (the feature
+// transformer, the layers' propagate, find_nnz, and the weight orderings
+// read_parameters applies) is templated on the instruction set, even though
+// a unit only ever uses it with its own CompiledIsa. That keeps the symbols
+// of each copy apart, so that a fat binary (FAT_BINARY=yes, see Makefile)
+// can link network_kernels.cpp once per instruction set and pick one at
+// startup. A native build links it once, for the flags of the build machine.
+enum class Isa {
+    Generic,
+    SSE2,
+    SSE41,
+    AVX2,
+    BMI2,
+    AVX512,
+    VNNI512,
+};
+
+// Instruction set of the unit being compiled
+#if defined(USE_VNNI)
+constexpr Isa CompiledIsa = Isa::VNNI512;
+#elif defined(USE_AVX512)
+constexpr Isa CompiledIsa = Isa::AVX512;
+#elif defined(USE_BMI2)
+constexpr Isa CompiledIsa = Isa::BMI2;
+#elif defined(USE_AVX2)
+constexpr Isa CompiledIsa = Isa::AVX2;
+#elif defined(USE_SSE41)
+constexpr Isa CompiledIsa = Isa::SSE41;
+#elif defined(USE_SSE2)
+constexpr Isa CompiledIsa = Isa::SSE2;
+#else
+constexpr Isa CompiledIsa = Isa::Generic;
+#endif
+
+// Instruction set of the kernels in use: in a fat binary the best one the
+// CPU supports, detected once, otherwise the one the binary was built for
+Isa activeIsa();
+
+const char* isaName(Isa isa);
+
+// Whether the CPU can run the code outside of the kernels. A fat binary
+// builds it for SSE4.1, POPCNT and BMI2, which the move generator needs.
+bool cpuSupported();
+
+
+// Calls fn(std::integral_constant<Isa, activeIsa()>()), for fn to call the
+// kernels compiled for the active instruction set. The cases must match the
+// FAT_ISAS of the Makefile: the others are not linked in.
+template<typename Fn>
+inline decltype(auto) withActiveIsa(Fn&& fn) {
+#if defined(FAT_BINARY)
+    switch (activeIsa())
+    {
+    case Isa::VNNI512 :
+        return fn(std::integral_constant<Isa, Isa::VNNI512>());
+    case Isa::AVX512 :
+        return fn(std::integral_constant<Isa, Isa::AVX512>());
+    case Isa::BMI2 :
+        return fn(std::integral_constant<Isa, Isa::BMI2>());
+    default :
+        return fn(std::integral_constant<Isa, Isa::SSE41>());
+    }
+#else
+    return fn(std::integral_constant<Isa, CompiledIsa>());
+#endif
+}
+
+}  // namespace Atom::NNUE
+
+#endif  // #ifndef NNUE_DISPATCH_H_INCLUDED
@@ -196,6 +196,7 @@ class FeatureTransformer {
 
    private:
 #ifdef VECTOR
+    // Only the kernels below use these, for the instruction set of their unit
     static constexpr int NumRegs =
       BestRegisterCount<vec_t, WeightType, TransformedFeatureDimensions, NumRegistersSIMD>();
     static constexpr int NumPsqtRegs =
@@ -223,6 +224,7 @@ class FeatureTransformer {
         return FeatureSet::HashValue ^ (OutputDimensions * 2);
     }
 
+    template<Isa I>
     static constexpr void order_packs([[maybe_unused]] uint64_t* v) {
 #if defined(USE_AVX512)  // _mm512_packs_epi16 ordering
         uint64_t tmp0 = v[2], tmp1 = v[3];
@@ -239,6 +241,7 @@ class FeatureTransformer {
 #endif
     }
 
+    template<Isa I>
     static constexpr void inverse_order_packs([[maybe_unused]] uint64_t* v) {
 #if defined(USE_AVX512)  // Inverse _mm512_packs_epi16 ordering
         uint64_t tmp0 = v[2], tmp1 = v[3];
@@ -255,6 +258,7 @@ class FeatureTransformer {
 #endif
     }
 
+    template<Isa I>
     void permute_weights([[maybe_unused]] void (*order_fn)(uint64_t*)) const {
 #if defined(USE_AVX2)
     #if defined(USE_AVX512)
@@ -291,39 +295,42 @@ class FeatureTransformer {
     }
 
     // Read network parameters
+    template<Isa I>
     bool read_parameters(std::istream& stream) {
 
         read_leb_128<BiasType>(stream, biases, HalfDimensions);
         read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
         read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
 
-        permute_weights(inverse_order_packs);
+        permute_weights<I>(inverse_order_packs<I>);
         scale_weights(true);
         return !stream.fail();
     }
 
     // Write network parameters
+    template<Isa I>
     bool write_parameters(std::ostream& stream) const {
 
-        permute_weights(order_packs);
+        permute_weights<I>(order_packs<I>);
         scale_weights(false);
 
         write_leb_128<BiasType>(stream, biases, HalfDimensions);
         write_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
         write_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
 
-        permute_weights(inverse_order_packs);
+        permute_weights<I>(inverse_order_packs<I>);
         scale_weights(true);
         return !stream.fail();
     }
 
     // Convert input features
+    template<Isa I>
     std::int32_t transform(const Position&                           pos,
                            AccumulatorCaches::Cache<HalfDimensions>* cache,
                            OutputType*                               output,
                            int                                       bucket) const {
-        update_accumulator<WHITE>(pos, cache);
-        update_accumulator<BLACK>(pos, cache);
+        update_accumulator<I, WHITE>(pos, cache);
+        update_accumulator<I, BLACK>(pos, cache);
 
         const Color perspectives[2]  = {pos.getSideToMove(), ~pos.getSideToMove()};
         const auto& psqtAccumulation = (pos.getState()->*accPtr).psqtAccumulation;
@@ -402,10 +409,11 @@ class FeatureTransformer {
         return psqt;
     }  // end of function transform()
 
+    template<Isa I>
     void hint_common_access(const Position&                           pos,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
-        hint_common_access_for_perspective<WHITE>(pos, cache);
-        hint_common_access_for_perspective<BLACK>(pos, cache);
+        hint_common_access_for_perspective<I, WHITE>(pos, cache);
+        hint_common_access_for_perspective<I, BLACK>(pos, cache);
     }
 
    private:
@@ -434,7 +442,7 @@ class FeatureTransformer {
     //       either be reachable by repeatedly applying ->previous from
     //       states_to_update[i+1], and computed_st must be reachable by
     //       repeatedly applying ->previous on states_to_update[0].
-    template<Color Perspective, size_t N>
+    template<Isa I, Color Perspective, size_t N>
     void update_accumulator_incremental(const Position& pos,
                                         BoardState*      computed_st,
                                         BoardState*      states_to_update[N]) const {
@@ -656,7 +664,7 @@ class FeatureTransformer {
 #endif
     }
 
-    template<Color Perspective>
+    template<Isa I, Color Perspective>
     void update_accumulator_refresh_cache(const Position&                           pos,
                                           AccumulatorCaches::Cache<HalfDimensions>* cache) const {
         assert(cache != nullptr);
@@ -813,7 +821,7 @@ class FeatureTransformer {
             entry.byTypeBB[pt] = pos.getPiecesBB(pt);
     }
 
-    template<Color Perspective>
+    template<Isa I, Color Perspective>
     void hint_common_access_for_perspective(const Position&                           pos,
                                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
 
@@ -832,13 +840,13 @@ class FeatureTransformer {
         {
             // Only update current position accumulator to minimize work
             BoardState* states_to_update[1] = {pos.getState()};
-            update_accumulator_incremental<Perspective, 1>(pos, oldest_st, states_to_update);
+            update_accumulator_incremental<I, Perspective, 1>(pos, oldest_st, states_to_update);
         }
         else
-            update_accumulator_refresh_cache<Perspective>(pos, cache);
+            update_accumulator_refresh_cache<I, Perspective>(pos, cache);
     }
 
-    template<Color Perspective>
+    template<Isa I, Color Perspective>
     void update_accumulator(const Position&                           pos,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
 
@@ -858,17 +866,17 @@ class FeatureTransformer {
             {
                 BoardState* states_to_update[1] = {next};
 
-                update_accumulator_incremental<Perspective, 1>(pos, oldest_st, states_to_update);
+                update_accumulator_incremental<I, Perspective, 1>(pos, oldest_st, states_to_update);
             }
             else
             {
                 BoardState* states_to_update[2] = {next, pos.getState()};
 
-                update_accumulator_incremental<Perspective, 2>(pos, oldest_st, states_to_update);
+                update_accumulator_incremental<I, Perspective, 2>(pos, oldest_st, states_to_update);
             }
         }
         else
-            update_accumulator_refresh_cache<Perspective>(pos, cache);
+            update_accumulator_refresh_cache<I, Perspective>(pos, cache);
     }
 
     template<IndexType Size>
@@ -0,0 +1,110 @@
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "numa.h"
+
+namespace Atom {
+
+namespace Numa {
+
+#if defined(__linux__)
+
+// Parses a cpulist from /sys, e.g "0-7,16-23"
+static std::vector<int> parseCpuList(const std::string& str) {
+    std::vector<int> cpus;
+    std::istringstream is(str);
+    std::string range;
+
+    while (std::getline(is, range, ',')) {
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+
+// Reads the NUMA topology from /sys. If it can not be read, all
+// the CPUs we are allowed to run on are treated as a single node.
+static NodeList readNodes() {
+    NodeList nodes;
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) {
+        return nodes;
+    }
+
+    for (int node = 0; ; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpuList;
+
+        if (!file || !std::getline(file, cpuList)) break;
+
+        std::vector<int> cpus;
+        for (const int cpu : parseCpuList(cpuList)) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+
+        if (!cpus.empty()) nodes.push_back(cpus);
+    }
+
+    if (nodes.empty()) {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+        nodes.push_back(cpus);
+    }
+
+    return nodes;
+}
+
+
+const NodeList& nodes() {
+    static const NodeList nodeList = readNodes();
+    return nodeList;
+}
+
+
+// Pins the calling thread to a single CPU. Consecutive thread indices are
+// spread across the NUMA nodes, then across the CPUs within each node.
+void bindThisThread(size_t idx) {
+    const NodeList& nodeList = nodes();
+    if (nodeList.empty()) return;
+
+    const std::vector<int>& cpus = nodeList[idx % nodeList.size()];
+    const int cpu = cpus[(idx / nodeList.size()) % cpus.size()];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(cpu_set_t), &set);
+}
+
+#else
+
+const NodeList& nodes() {
+    static const NodeList nodeList;
+    return nodeList;
+}
+
+// Thread binding is only supported on linux.
+void bindThisThread(size_t idx) {}
+
+#endif
+
+} // namespace Numa
+
+} // namespace Atom
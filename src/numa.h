@@ -0,0 +1,22 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+namespace Atom {
+
+namespace Numa {
+
+// CPUs of each NUMA node, restricted to the CPUs this process may run on.
+using NodeList = std::vector<std::vector<int>>;
+
+const NodeList& nodes();
+
+void bindThisThread(size_t idx);
+
+} // namespace Numa
+
+} // namespace Atom
+
+#endif // NUMA_H
@@ -7,6 +7,7 @@
 #include "zobrist.h"
 #include "uci.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -235,16 +236,20 @@ Position::Position() {
 // Creates a copy of another position.
 Position::Position(const Position &other) {
     history = new BoardState[MAX_HISTORY];
-    std::memcpy(this, &other, sizeof(Position));
-    this->state = this->history + (other.state - other.history);
+    *this = other;
 }
 
 
 // Copy assignment operator
 Position& Position::operator=(const Position &other) {
     if (this == &other) return *this; // Self assignment check
+
+    // Keep our own history buffer, only the states up to the current one are copied
+    BoardState *ownHistory = history;
     std::memcpy(this, &other, sizeof(Position));
-    this->state = this->history + (other.state - other.history);
+    history = ownHistory;
+    state = history + (other.state - other.history);
+    std::memcpy(history, other.history, (other.state - other.history + 1) * sizeof(BoardState));
 
     return *this;
 }
@@ -256,9 +261,53 @@ Position::~Position() {
 }
 
 
+// Copies the position into a snapshot, see PositionSnapshot.
+void Position::takeSnapshot(PositionSnapshot& snapshot) const {
+    std::memcpy(snapshot.pieces,   pieces,   sizeof(pieces));
+    std::memcpy(snapshot.sideBB,   sideBB,   sizeof(sideBB));
+    std::memcpy(snapshot.piecesBB, piecesBB, sizeof(piecesBB));
+    snapshot.sideToMove = sideToMove;
+    std::memcpy(snapshot.state, state, BOARD_STATE_COPY_SIZE);
+
+    // Keep the states that isRepetitionDraw() can reach from here, leaving
+    // the search enough room for MAX_PLY more states after them
+    const BoardState *start = std::max({state - getHalfMoveClock(), history + 2, state - (MAX_HISTORY - MAX_PLY - 4)});
+
+    snapshot.hashHistory.clear();
+    for (const BoardState *st = start; st < state; ++st) {
+        snapshot.hashHistory.push_back(st->hash);
+    }
+}
+
+
+// Sets the position from a snapshot. Only the hashes of the earlier states
+// are restored, which is all that repetition detection looks at. The root
+// state has no previous state, so NNUE refreshes its accumulators from scratch.
+void Position::loadSnapshot(const PositionSnapshot& snapshot) {
+    std::memcpy(pieces,   snapshot.pieces,   sizeof(pieces));
+    std::memcpy(sideBB,   snapshot.sideBB,   sizeof(sideBB));
+    std::memcpy(piecesBB, snapshot.piecesBB, sizeof(piecesBB));
+    sideToMove = snapshot.sideToMove;
+
+    // isRepetitionDraw() never looks at the first two states
+    state = history + 2;
+    for (const uint64_t hash : snapshot.hashHistory) {
+        (state++)->hash = hash;
+    }
+
+    std::memcpy(state, snapshot.state, BOARD_STATE_COPY_SIZE);
+    state->previous = nullptr;
+    state->accumulatorBig.computed[WHITE] = state->accumulatorBig.computed[BLACK] =
+        state->accumulatorSmall.computed[WHITE] = state->accumulatorSmall.computed[BLACK] = false;
+}
+
+
 // Resets the current position to empty.
 void Position::reset() {
     state = &history[0];
+    state->previous = nullptr;
+    state->accumulatorBig.computed[WHITE] = state->accumulatorBig.computed[BLACK] =
+        state->accumulatorSmall.computed[WHITE] = state->accumulatorSmall.computed[BLACK] = false;
 
     state->fiftyMoveRule = 0;
     state->halfMoves = 0;
@@ -698,11 +747,13 @@ template void Position::undoMove<BLACK, MT_EN_PASSANT>(Move m);
 template void Position::undoMove<BLACK, MT_CASTLING>(Move m);
 
 template<Color Me>
-void Position::doNullMove(BoardState& nullState, TranspositionTable& tt) {
-    std::memcpy(&nullState, state, offsetof(BoardState, accumulatorBig));
+void Position::doNullMove(TranspositionTable& tt) {
+    // The null move takes the next history slot, so moves made after it keep
+    // writing into the history array and undoNullMove only has to step back
+    BoardState *oldState = state++;
+    std::memcpy(state, oldState, offsetof(BoardState, accumulatorBig));
 
-    nullState.previous = state;
-    state = &nullState;
+    state->previous = oldState;
 
     state->dirtyPiece.dirty_num = 0;
     state->dirtyPiece.piece[0]  = NO_PIECE;
@@ -723,8 +774,8 @@ void Position::doNullMove(BoardState& nullState, TranspositionTable& tt) {
 
 }
 
-template void Position::doNullMove<WHITE>(BoardState& newState, TranspositionTable& tt);
-template void Position::doNullMove<BLACK>(BoardState& newState, TranspositionTable& tt);
+template void Position::doNullMove<WHITE>(TranspositionTable& tt);
+template void Position::doNullMove<BLACK>(TranspositionTable& tt);
 
 template<Color Me> void Position::undoNullMove() {
     state--;
@@ -8,8 +8,10 @@
 #include "types.h"
 #include "zobrist.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <sstream>
+#include <vector>
 
 namespace Atom {
 
@@ -50,6 +52,25 @@ struct BoardState {
 };
 
 
+// Size of the part of a BoardState before the NNUE accumulators. This is all
+// that needs to be copied to set up a new state, the accumulators are
+// recomputed when they are needed.
+constexpr size_t BOARD_STATE_COPY_SIZE = offsetof(BoardState, accumulatorBig);
+
+// Compact copy of a position, used to hand the root position to the search
+// threads. Holds the piece placement, the current board state without its
+// accumulators, and the hashes of the earlier states that repetition
+// detection can still reach, instead of the full history.
+struct PositionSnapshot {
+    Piece     pieces[SQUARE_NB];
+    Bitboard  sideBB[COLOR_NB];
+    Bitboard  piecesBB[PIECE_NB];
+    Color     sideToMove;
+    std::byte state[BOARD_STATE_COPY_SIZE];
+    std::vector<uint64_t> hashHistory;
+};
+
+
 class Position {
 public:
     Position();                                     // Default constructor.
@@ -65,13 +86,16 @@ public:
     std::string fen() const;                        // Returns FEN of current position.
     std::string printable() const;                  // Returns printable representation of the board.
 
+    void takeSnapshot(PositionSnapshot& snapshot) const;  // Copies the position into a snapshot.
+    void loadSnapshot(const PositionSnapshot& snapshot);  // Sets the position from a snapshot.
+
     // Make and unmake the given move
     inline void doMove(Move m)   { getSideToMove() == WHITE ? doMove<WHITE>(m)   : doMove<BLACK>(m); }
-    inline void undoMove(Move m) { getSideToMove() == WHITE ? undoMove<WHITE>(m) : undoMove<BLACK>(m); }
+    inline void undoMove(Move m) { getSideToMove() == BLACK ? undoMove<WHITE>(m) : undoMove<BLACK>(m); }
     template <Color Me> inline void doMove(Move m);
     template <Color Me> inline void undoMove(Move m);
 
-    template <Color Me> void doNullMove(BoardState& newState, TranspositionTable& tt);
+    template <Color Me> void doNullMove(TranspositionTable& tt);
     template <Color Me> void undoNullMove();
 
     // Returns position metadata.
@@ -5,6 +5,7 @@
 #include <cstdint>
 
 #include "search.h"
+#include "alloccount.h"
 #include "evaluate.h"
 #include "movegen.h"
 #include "movepicker.h"
@@ -21,11 +22,46 @@ namespace Search {
 
 
 void SearchWorker::clear() {
+    cacheTable.clear(networks);
+    evalCache.clear();
+    mainHistory.clear();
+    captureHistory.clear();
+    contHistory.clear();
+    counterMoves.clear();
+}
+
+
+void SearchWorker::initReductions(size_t nbThreads) {
     for (size_t i = 1; i < reductions.size(); ++i) {
-        reductions[i] = int((Tunables::REDUCTION_AMOUNT + std::log(size_t(threads.size())) / 2) * std::log(i));
+        reductions[i] = int((Tunables::REDUCTION_AMOUNT + std::log(nbThreads) / 2) * std::log(i));
     }
+}
 
-    cacheTable.clear(networks);
+
+// Resets the per search state of the worker. Called before every search.
+void SearchWorker::onNewSearch() {
+    counters.nodes = counters.tbHits = 0;
+    publishCounters();
+
+    ttStats  = TTStats();
+    qttStats = TTStats();
+    evalCacheStats = Eval::EvalCacheStats();
+    cutoffStats = CutoffStats();
+    searchStats = SearchStats();
+
+    searchDepth = completedDepth = selDepth = 0;
+    nmpCutoff   = 0;
+    multiPV     = 1;
+    pvIdx       = 0;
+
+    bestMoveChanges    = 0;
+    totBestMoveChanges = 0;
+
+    // Age the tables before any thread is released
+    if (isFirstThread()) {
+        tt.onNewSearch();
+        qtt.onNewSearch();
+    }
 }
 
 
@@ -36,60 +72,108 @@ void SearchWorker::onNewPv(
     const TranspositionTable& tt,
     Depth depth
 ) {
+    // Our own counters may lag behind, the helpers' are published often enough
+    publishCounters();
+
     const uint64_t totalNodesSearched = threads.totalNodesSearched();
     const uint64_t totalTbHits        = threads.totalTbHits();
 
     const RootMoveList& rootMoves = bestWorker.rootMoves;
     const Position&     rootPos   = bestWorker.rootPosition;
+    const TimePoint     elapsed   = now() - bestWorker.limits.startTimePoint;
+    const int           hashFull  = tt.hashfull();
 
-    std::string pv;
-    for (const Move m : rootMoves[0].pv) {
-        pv += Uci::formatMove(m) + " ";
-    }
+    // One line per MultiPV move
+    const size_t nbLines = std::min(threads.multiPV, rootMoves.size());
+
+    for (size_t i = 0; i < nbLines; ++i) {
+        // Lines that have not been searched at this depth yet show the last one
+        const bool  updated = rootMoves[i].score != -VALUE_INFINITE;
+        const Value v       = updated ? rootMoves[i].score : rootMoves[i].prevScore;
 
-    SearchInfo info;
+        if (v == -VALUE_INFINITE) continue;
+
+        // SearchInfo only holds views, keep the score alive until the callback
+        const std::string score = Uci::formatScore(v, rootPos);
+
+        SearchInfo info;
+
+        info.depth         = updated ? depth : std::max(1, depth - 1);
+        info.selDepth      = rootMoves[i].selDepth;
+        info.multiPV       = i + 1;
+        info.score         = score;
+        info.nodesSearched = totalNodesSearched;
+        info.timeSearched  = elapsed;
+        info.hashFull      = hashFull;
+        info.tbHits        = totalTbHits;
+        info.pv            = {rootMoves[i].pv.begin(), rootMoves[i].pv.size()};
+
+        Uci::callbackInfo(info);
+    }
 
-    info.depth         = depth;
-    info.selDepth      = rootMoves[0].selDepth;
-    info.score         = Uci::formatScore(rootMoves[0].score, rootPos);
-    info.nodesSearched = totalNodesSearched;
-    info.hashFull      = tt.hashfull();
-    info.tbHits        = totalTbHits;
-    info.pv            = pv;
+    // Effort spent on each root move, in the order they will be searched next
+    if (threads.reportRootMoveNodes) {
+        uint64_t rootNodes = 0;
+        for (const RootMove& rm : rootMoves) {
+            rootNodes += rm.nodes;
+        }
 
-    Uci::callbackInfo(info);
+        for (const RootMove& rm : rootMoves) {
+            Uci::callbackRootMoveNodes(depth, rm.pv[0], rm.nodes, rootNodes);
+        }
+    }
 }
 
 
 void SearchWorker::startSearch() {
+    // The search should not allocate (only checked with ALLOC_COUNT)
+    [[maybe_unused]] AllocCount::Scope allocScope;
 
-    // All threads except the first one go straight to searching
-    if (!isFirstThread()) {
-        assert(threads.size() > 1);
+    // Every thread sets up its own copy of the root, in parallel
+    rootPosition.loadSnapshot(threads.rootSnapshot);
+    rootMoves = threads.rootMoves;
+    limits    = threads.searchLimits;
+
+    scheduleCheckup();
+    tracer.start(idx);
+    threads.onSearchStarted();
 
-        iterativeDeepening();
+    // All threads except the first one go straight to searching.
+    // With go mate, the first thread tries the proof-number search first,
+    // while the others look for the mate with the normal search.
+    if (!isFirstThread()) {
+        if (!rootMoves.empty()) {
+            iterativeDeepening();
+        }
+        tracer.finish();
         return;
     }
 
-    // We only want the following code to be run once:
-    // it will only be run by the first thread.
-    tt.onNewSearch();
-
+    // The following code is only run by the first thread.
+    // The other threads were released at the same time, and are already searching.
     if (!rootMoves.empty()) {
-        // Start all the other threads going
-        threads.startSearching();
-        iterativeDeepening();
+        if (!limits.mate || !solveMate()) {
+            iterativeDeepening();
+        }
     } else {
         // Make sure we have at least something to return
         rootMoves.push_back(Move::MOVE_NONE);
     }
 
-    // If the search is infinite, wait here and do nothing.
-    while (limits.isInfinite && !threads.shouldStop) {}
+    tracer.finish();
+
+    // If the search is infinite, sleep here until we are told to stop.
+    // Same when pondering: ponderhit stops the search once this flag is set.
+    // The flag is set before ponder is read, and ponderhit clears ponder
+    // before reading the flag, so one of the two always sees the other.
+    threads.stopOnPonderhit = true;
+    if (limits.isInfinite || threads.ponder) {
+        threads.waitForStop();
+    }
 
     // Wait for the other threads to stop
-    threads.shouldStop = true;
-    threads.waitForFinish();
+    threads.stop();
+    threads.waitForHelpers();
 
     SearchWorker* bestWorker = threads.bestThread()->worker.get();
 
@@ -104,104 +188,195 @@ void SearchWorker::startSearch() {
     }
 
     Uci::callbackBestMove(bestmove, ponder);
+    threads.onBestMove(bestWorker->rootMoves[0].pv[0]);
+}
+
+
+// Periodic checkup, run by countNode when the countdown reaches zero.
+// Publishes the counters and stops the search as soon as a node or time
+// limit has been reached.
+void SearchWorker::checkup() {
+    publishCounters();
+
+    if (limits.nodes && threads.totalNodesSearched() >= limits.nodes) {
+        threads.stop();
+    }
+
+    const TimeManager& tm = threads.timeManager;
+    if (isFirstThread() && tm.enabled() && !threads.ponder && tm.elapsed() >= tm.maximum()) {
+        threads.stop();
+    }
+
+    scheduleCheckup();
+}
+
+
+// Sets the number of nodes until the next checkup. Near a node limit, the
+// checkups get closer so that the limit is not overshot: each thread only
+// searches its share of the nodes left. A single thread then stops on the
+// exact node, which makes node limited searches reproducible.
+void SearchWorker::scheduleCheckup() {
+    counters.checkupCountdown = COUNTER_PUBLISH_INTERVAL;
+
+    if (limits.nodes) {
+        const uint64_t searched = threads.totalNodesSearched();
+        const uint64_t left     = searched < limits.nodes ? limits.nodes - searched : 0;
+
+        counters.checkupCountdown = std::clamp<uint64_t>(left / threads.size(), 1, COUNTER_PUBLISH_INTERVAL);
+    }
 }
 
 
 template<Color Me>
 void SearchWorker::iterativeDeepening() {
 
-    Value bestValue = -VALUE_INFINITE, lastBestValue = -VALUE_INFINITE;
+    Value bestValue = -VALUE_INFINITE, previousScore = VALUE_NONE;
     Value alpha = -VALUE_INFINITE, beta = VALUE_INFINITE;
     Value delta, avg;
 
-    Move bestPV[MAX_PLY + 1];
     MoveList lastBestPV;
 
-    StackObject stack[MAX_PLY + 2];
-    StackObject* sPtr = stack;
+    // The entries before the root are only read, by the continuation
+    // histories and the improving heuristics: they look like a quiet line.
+    StackObject stack[STACK_OFFSET + MAX_PLY + 2];
+    StackObject* sPtr = stack + STACK_OFFSET;
 
     // Set up stack ply
-    for (int i = 0; i < MAX_PLY + 2; ++i) {
-        (sPtr + i)->ply = i;
+    for (int i = -STACK_OFFSET; i < MAX_PLY + 2; ++i) {
+        (sPtr + i)->ply         = i;
+        (sPtr + i)->staticEval  = VALUE_ZERO;
+        (sPtr + i)->currentMove = MOVE_NONE;
+        (sPtr + i)->statScore   = 0;
+        (sPtr + i)->contHist    = contHistory.sentinel();
     }
 
     Depth searchUpTo;
 
-    sPtr->pv = bestPV;
+    sPtr->pv = pvLines[0].data();
+
+    multiPV = std::min(threads.multiPV, rootMoves.size());
 
     // Main iterative deepening loop
     while (++searchDepth < MAX_PLY && !threads.shouldStop
         && !(limits.depth && searchDepth > limits.depth && isFirstThread())) {
 
-        // Reset selDepth
-        selDepth = 0;
+        // Lazy SMP helpers skip some depths, once they have a first result to vote with.
+        // With ABDADA all threads search the same depth, the deferral splits the work.
+        if (!isFirstThread() && threads.parallelMode == ParallelMode::LAZY_SMP
+            && completedDepth && skipDepth(searchDepth)) {
+            continue;
+        }
 
-        // Reset aspiration window
-        avg = rootMoves[0].avgScore;
-        delta = Tunables::ASPIRATION_WINDOW_SIZE + std::abs(avg) / Tunables::ASPIRATION_WINDOW_DIVISOR;
-        alpha = std::max(-VALUE_INFINITE, avg - delta);
-        beta  = std::min( VALUE_INFINITE, avg + delta);
+        const uint64_t iterationStartNodes = counters.nodes;
 
-        int failedHigh = 0;
-        while (true) {
+        // Keep the scores of the last iteration, for the lines not searched yet
+        for (RootMove& rm : rootMoves) {
+            rm.prevScore = rm.score;
+        }
 
-            rootDelta  = beta - alpha;
-            searchUpTo = std::max(1, searchDepth - failedHigh);
-            bestValue  = pvSearch<Me, NODETYPE_ROOT>(rootPosition, sPtr, alpha, beta, searchUpTo, false);
+        // MultiPV: search the best multiPV root moves one after the other, each
+        // with its own window. Line pvIdx only searches the moves from pvIdx on.
+        for (pvIdx = 0; pvIdx < multiPV && !threads.shouldStop; ++pvIdx) {
 
-            // Sort moves such that we search the best move first (highest score -> lowest score)
-            std::stable_sort(rootMoves.begin(), rootMoves.end());
+            // Reset selDepth
+            selDepth = 0;
 
-            if (threads.shouldStop) break;
+            // Reset aspiration window, helpers use wider windows
+            avg = rootMoves[pvIdx].avgScore;
+            delta = Tunables::ASPIRATION_WINDOW_SIZE + (idx % 4) * Tunables::SMP_ASPIRATION_STEP
+                  + std::abs(avg) / Tunables::ASPIRATION_WINDOW_DIVISOR;
+            alpha = std::max(-VALUE_INFINITE, avg - delta);
+            beta  = std::min( VALUE_INFINITE, avg + delta);
 
-            if (isFirstThread() && (bestValue <= alpha || bestValue >= beta) && nodes > Tunables::UPDATE_NODES) {
-                onNewPv(*this, threads, tt, searchDepth);
-            }
+            int failedHigh = 0;
+            while (true) {
 
-            // fail low
-            if (bestValue <= alpha) {
-                beta = (alpha + beta) / 2;
-                alpha = std::max(-VALUE_INFINITE, bestValue - delta);
-                failedHigh = 0;
-            }
+                rootDelta  = beta - alpha;
+                searchUpTo = std::max(1, searchDepth - failedHigh);
+                bestValue  = pvSearch<Me, NODETYPE_ROOT>(rootPosition, sPtr, alpha, beta, searchUpTo, false);
 
-            // Fail high
-            else if (bestValue >= beta) {
-                beta = std::min(VALUE_INFINITE, bestValue + delta);
-               ++failedHigh;
-            }
+                // Sort moves such that we search the best move first (highest score -> lowest score)
+                sortRootMoves(rootMoves.begin() + pvIdx, rootMoves.end());
 
-            else {
-                break;
-            }
+                if (threads.shouldStop) break;
+
+                if (isFirstThread() && (bestValue <= alpha || bestValue >= beta) && counters.nodes > Tunables::UPDATE_NODES) {
+                    onNewPv(*this, threads, tt, searchDepth);
+                }
 
-            delta += delta / Tunables::DELTA_INCREMENT_DIV;
+                // fail low
+                if (bestValue <= alpha) {
+                    countStat(searchStats.aspirationFailLows);
+                    beta = (alpha + beta) / 2;
+                    alpha = std::max(-VALUE_INFINITE, bestValue - delta);
+                    failedHigh = 0;
+                }
+
+                // Fail high
+                else if (bestValue >= beta) {
+                    countStat(searchStats.aspirationFailHighs);
+                    beta = std::min(VALUE_INFINITE, bestValue + delta);
+                   ++failedHigh;
+                }
 
-            assert(alpha >= -VALUE_INFINITE && beta <= VALUE_INFINITE);
+                else {
+                    break;
+                }
+
+                delta += delta / Tunables::DELTA_INCREMENT_DIV;
+
+                assert(alpha >= -VALUE_INFINITE && beta <= VALUE_INFINITE);
+            }
+
+            // Sort the lines searched so far
+            sortRootMoves(rootMoves.begin(), rootMoves.begin() + pvIdx + 1);
         }
 
         // Send update to the GUI
         // Must do this before stopping
-        if (isFirstThread() && (nodes > Tunables::UPDATE_NODES || threads.shouldStop) && !threads.abortSearch) {
+        if (isFirstThread() && (counters.nodes > Tunables::UPDATE_NODES || threads.shouldStop) && !threads.abortSearch) {
             onNewPv(*this, threads, tt, searchDepth);
         }
 
         if (!threads.shouldStop) {
             completedDepth = searchDepth;
+            countStat(searchStats.iterationNodes[searchDepth], counters.nodes - iterationStartNodes);
         } else {
             break;
         }
 
         // If we have had a PV update
         if (rootMoves[0].pv[0] != lastBestPV[0]) {
-            lastBestPV    = rootMoves[0].pv;
-            lastBestValue = rootMoves[0].score;
+            lastBestPV = rootMoves[0].pv;
         }
 
-        if (!limits.isInfinite && !threads.shouldStop) {
-            // TODO: Time management
+        // go mate: stop as soon as a mate in the given number of moves is found
+        if (isFirstThread() && limits.mate && rootMoves[0].score >= VALUE_MATE - (2 * limits.mate - 1)) {
+            threads.stop();
         }
+
+        // Decide whether there is time for another iteration
+        if (isFirstThread() && threads.timeManager.enabled()) {
+            totBestMoveChanges = totBestMoveChanges / 2 + bestMoveChanges;
+            bestMoveChanges    = 0;
+
+            const Value scoreDrop = previousScore == VALUE_NONE ? 0 : previousScore - rootMoves[0].score;
+            const int   effort    = int(rootMoves[0].nodes * 100 / std::max<uint64_t>(counters.nodes, 1));
+
+            if (threads.timeManager.shouldStopIterating(totBestMoveChanges, scoreDrop, effort)) {
+                // While pondering, keep searching until the opponent moves
+                if (threads.ponder) {
+                    threads.stopOnPonderhit = true;
+                } else {
+                    threads.stop();
+                }
+            }
+        }
+
+        previousScore = rootMoves[0].score;
     }
+
+    publishCounters();
 }
 
 
@@ -218,12 +393,15 @@ Value SearchWorker::pvSearch(
         return qSearch<Me, QNodeType>(pos, sPtr, alpha, beta, 0);
     }
 
+    Trace::NodeTrace trace(tracer, pos.hash(), sPtr->ply, depth, alpha, beta,
+                           RootNode ? Trace::NODE_ROOT : PvNode ? Trace::NODE_PV : Trace::NODE_NON_PV, (sPtr - 1)->currentMove);
+
     if constexpr (!RootNode) {
         // See if search has been aborted
         if (threads.shouldStop.load(std::memory_order_relaxed) || pos.isDraw()) {
-            return (sPtr->inCheck && sPtr->ply >= MAX_PLY)
-                ? Eval::evaluate<Me>(pos, networks, cacheTable)
-                : VALUE_DRAW - 1 + (nodes & 0x2);
+            return trace.exit((sPtr->inCheck && sPtr->ply >= MAX_PLY)
+                ? evaluate<Me>(pos)
+                : VALUE_DRAW - 1 + (counters.nodes & 0x2), Trace::REASON_DRAW);
         }
 
         // Mate distance pruning.
@@ -231,7 +409,7 @@ Value SearchWorker::pvSearch(
         // don't keep searching: we will not be able to beat that score
         alpha = std::max(alpha, -VALUE_MATE + sPtr->ply);
         beta  = std::min(beta ,  VALUE_MATE - sPtr->ply - 1);
-        if (alpha >= beta) return alpha;
+        if (alpha >= beta) return trace.exit(alpha, Trace::REASON_MATE_DISTANCE);
     }
 
     assert(-VALUE_INFINITE <= alpha && alpha < beta && beta <= VALUE_INFINITE);
@@ -242,31 +420,30 @@ Value SearchWorker::pvSearch(
     // Make sure the depth does not go higher than max ply
     depth = std::min(depth, MAX_PLY - 1);
 
-    Move pv[MAX_PLY + 1];
+    Move* const pv = pvLines[sPtr->ply + 1].data();  // Line of the child being searched
     Move currentMove, bestMove = MOVE_NONE;
     Value bestScore = -VALUE_INFINITE;
     Value maxScore  =  VALUE_INFINITE;
 
     bool improving, oppWorsening;
     Value eval;
-    BoardState tempBoardState;
 
     sPtr->inCheck        = pos.inCheck();
     sPtr->moveCount      = 0;
+    sPtr->statScore      = 0;
     (sPtr + 1)->killer   = MOVE_NONE;
 
     // Transposition table probe
     auto [ttHit, ttData, ttWriter] = tt.probe(pos.hash());
     sPtr->ttHit = ttHit;
+    updateTTStats<Me>(ttStats, pos, ttHit, ttData.move);
 
-    ttData.move = RootNode ? rootMoves[0].pv[0]
+    ttData.move = RootNode ? rootMoves[pvIdx].pv[0]
                   : ttHit  ? ttData.move
                            : MOVE_NONE;
 
     ttData.score = ttHit ? ttData.getAdjustedScore(sPtr->ply) : VALUE_NONE;
 
-    // TODO: Time management should quickly check time here
-
     // update selDepth
     if (PvNode && selDepth < sPtr->ply + 1) {
         selDepth = sPtr->ply + 1;
@@ -276,7 +453,7 @@ Value SearchWorker::pvSearch(
     if (!PvNode && ttHit && ttData.depth > depth - (ttData.score <= beta) &&
         ttData.score != VALUE_NONE &&
         ttData.bound & (ttData.score >= beta ? BOUND_LOWER : BOUND_UPPER)) {
-      return ttData.score;
+      return trace.exit(ttData.score, Trace::REASON_TT_CUTOFF, ttData.move);
     }
 
 
@@ -285,16 +462,18 @@ Value SearchWorker::pvSearch(
 
     if (!sPtr->inCheck) {
         if (ttHit) {
-            sPtr->staticEval = eval = (ttData.eval != VALUE_NONE ? ttData.eval : clampEval(Eval::evaluate<Me>(pos, networks, cacheTable)));
+            sPtr->staticEval = eval = (ttData.eval != VALUE_NONE ? ttData.eval : clampEval(evaluate<Me>(pos)));
             if (ttData.score != VALUE_NONE && ttData.bound & (ttData.score > eval ? BOUND_LOWER : BOUND_UPPER)) {
                 eval = ttData.score;
             }
         } else {
-          sPtr->staticEval = eval = clampEval(Eval::evaluate<Me>(pos, networks, cacheTable));
+          sPtr->staticEval = eval = clampEval(evaluate<Me>(pos));
           ttWriter.write(pos.hash(), VALUE_NONE, eval, -2, sPtr->ttPv,
                          MOVE_NONE, tt.getAge(), BOUND_NONE);
         }
 
+        trace.setEval(sPtr->staticEval);
+
         // Check if we are improving / opponent is worsening
         improving    = sPtr->staticEval > (sPtr - 2)->staticEval;
         oppWorsening = sPtr->staticEval + (sPtr - 1)->staticEval > 2;
@@ -303,16 +482,20 @@ Value SearchWorker::pvSearch(
         if (!PvNode && !sPtr->inCheck && depth <= Tunables::RFP_DEPTH &&
             eval - (Tunables::RFP_DEPTH_MULTIPLIER * depth) >= beta
         ) {
-            return eval;
+            countStat(searchStats.rfp);
+            return trace.exit(eval, Trace::REASON_RFP);
         }
 
         // Razoring
         if (!PvNode && !sPtr->inCheck && depth <= Tunables::RAZORING_DEPTH &&
             eval + (Tunables::RAZORING_DEPTH_MULTIPLIER * depth) >= beta
         ) {
-            Value score = qSearch<Me, QNodeType>(pos, sPtr, alpha, alpha - 1, 0);
+            countStat(searchStats.razoringTries);
+
+            Value score = qSearch<Me, QNodeType>(pos, sPtr, alpha - 1, alpha, 0);
             if (score < alpha && std::abs(score) < VALUE_TB_WIN_IN_MAX_PLY) {
-                return score;
+                countStat(searchStats.razoringCuts);
+                return trace.exit(score, Trace::REASON_RAZORING);
             }
         }
 
@@ -323,7 +506,8 @@ Value SearchWorker::pvSearch(
             && beta > VALUE_TB_LOSS_IN_MAX_PLY
             && eval < VALUE_TB_WIN_IN_MAX_PLY
         ) {
-            return beta + (eval - beta) / 3;
+            countStat(searchStats.futility);
+            return trace.exit(beta + (eval - beta) / 3, Trace::REASON_FUTILITY);
         }
 
         // Null move pruning
@@ -336,10 +520,13 @@ Value SearchWorker::pvSearch(
 
             assert(eval - beta >= 0);
 
+            countStat(searchStats.nmpTries);
+
             Depth R = getNullMoveReductionAmount(eval, beta, depth);
             sPtr->currentMove = MOVE_NULL;
+            sPtr->contHist    = contHistory.sentinel();
 
-            pos.doNullMove<Me>(tempBoardState, tt);
+            pos.doNullMove<Me>(tt);
             Value nullSearchScore = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -beta, -beta + 1, depth - R, false);
             pos.undoNullMove<Me>();
 
@@ -347,7 +534,8 @@ Value SearchWorker::pvSearch(
 
                 // Ensure we don't run verification search too often
                 if (nmpCutoff || depth < Tunables::NMP_VERIFICATION_MIN_DEPTH) {
-                    return nullSearchScore;
+                    countStat(searchStats.nmpCuts);
+                    return trace.exit(nullSearchScore, Trace::REASON_NULL_MOVE);
                 }
 
                 assert(!nmpCutoff);  // Recursive verification is not allowed
@@ -355,12 +543,64 @@ Value SearchWorker::pvSearch(
                 nmpCutoff = sPtr->ply + Tunables::NMP_DEPTH_SCALE * (depth - R) / Tunables::NMP_DEPTH_DIVISOR;
 
                 // Verification search
+                countStat(searchStats.nmpVerifications);
                 Value v = pvSearch<Me, NODETYPE_NON_PV>(pos, sPtr, beta - 1, beta, depth - R, false);
 
                 nmpCutoff = 0;
 
                 if (v >= beta) {
-                    return nullSearchScore;
+                    countStat(searchStats.nmpCuts);
+                    return trace.exit(nullSearchScore, Trace::REASON_NULL_MOVE);
+                }
+
+                countStat(searchStats.nmpVerificationFails);
+            }
+        }
+
+        // ProbCut: if a good capture beats beta by a margin at a reduced depth,
+        // the full depth search would most likely fail high too. Skipped when
+        // the TT already says the search stays below the raised beta.
+        const Value probCutBeta = beta + Tunables::PROBCUT_MARGIN - Tunables::PROBCUT_IMPROVING_MARGIN * improving;
+        if (!PvNode && depth >= Tunables::PROBCUT_MIN_DEPTH
+            && std::abs(beta) < VALUE_TB_WIN_IN_MAX_PLY
+            && !(ttData.depth >= depth - 3 && ttData.score != VALUE_NONE && ttData.score < probCutBeta)
+        ) {
+            assert(probCutBeta < VALUE_INFINITE);
+
+            countStat(searchStats.probcutTries);
+
+            const Depth probCutDepth = depth - Tunables::PROBCUT_DEPTH_REDUCTION;
+
+            // Uses this ply's move list: the main move picker is not built yet
+            Movepicker::MovePicker<Me> pcMp(pos, ttData.move, probCutBeta - sPtr->staticEval, mainHistory, captureHistory,
+                                            moveLists[sPtr->ply].picker);
+
+            while ((currentMove = pcMp.nextMove()) != MOVE_NONE) {
+                sPtr->currentMove = currentMove;
+                sPtr->contHist    = &contHistory.at(pos.getPieceAt(moveFrom(currentMove)), moveTo(currentMove));
+
+                countNode();
+                pos.doMove<Me>(currentMove);
+
+                // A quiescence search first, to drop the captures that do not hold
+                Value score = -qSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -probCutBeta, -probCutBeta + 1, 0);
+
+                if (score >= probCutBeta) {
+                    score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -probCutBeta, -probCutBeta + 1, probCutDepth, !cutNode);
+                }
+
+                pos.undoMove<Me>(currentMove);
+
+                if (threads.shouldStop.load(std::memory_order_relaxed)) return trace.exit(VALUE_ZERO, Trace::REASON_ABORTED);
+
+                if (score >= probCutBeta) {
+                    countStat(searchStats.probcutCuts);
+
+                    ttWriter.write(pos.hash(), valueToTT(score, sPtr->ply), sPtr->staticEval, probCutDepth + 1,
+                                   sPtr->ttPv, currentMove, tt.getAge(), BOUND_LOWER);
+
+                    return trace.exit(std::abs(score) < VALUE_TB_WIN_IN_MAX_PLY ? score - (probCutBeta - beta) : score,
+                                      Trace::REASON_PROBCUT, currentMove);
                 }
             }
         }
@@ -372,7 +612,7 @@ Value SearchWorker::pvSearch(
 
         // Quiescense search if the depth was reduced
         if (depth <= 0) {
-            return qSearch<Me, QNodeType>(pos, sPtr, alpha, beta, 0);
+            return trace.exit(qSearch<Me, QNodeType>(pos, sPtr, alpha, beta, 0), Trace::REASON_QSEARCH);
         }
 
         // Decrease depth for cutnodes
@@ -388,7 +628,17 @@ Value SearchWorker::pvSearch(
         improving = false;
     }
 
-    Movepicker::MovePicker<Me> mp(pos, ttData.move, sPtr->killer, depth);
+    const PieceToHistory* contHist[CONT_HIST_NB];
+    for (int i = 0; i < CONT_HIST_NB; ++i) {
+        contHist[i] = (sPtr - CONT_HIST_PLIES[i])->contHist;
+    }
+
+    // Counter move to the opponent's last move
+    const Move   prevMove    = (sPtr - 1)->currentMove;
+    const Move   counterMove = isValidMove(prevMove) ? counterMoves.at(pos.getPieceAt(moveTo(prevMove)), moveTo(prevMove)) : MOVE_NONE;
+
+    Movepicker::MovePicker<Me> mp(pos, ttData.move, sPtr->killer, counterMove, depth, mainHistory, captureHistory, contHist,
+                                  moveLists[sPtr->ply].picker);
 
     int nMoves = 0;
     int reduction;
@@ -399,19 +649,53 @@ Value SearchWorker::pvSearch(
     Value score;
     Depth newDepth;
 
+    // Moves searched so far, they are penalised if another move cuts off
+    Move* const quietsSearched   = moveLists[sPtr->ply].quiets;
+    Move* const capturesSearched = moveLists[sPtr->ply].captures;
+    int  nQuiets = 0, nCaptures = 0;
+
+    // ABDADA: moves that another thread is searching are put aside, and only
+    // searched once the move picker has run out of moves
+    const bool canDefer = threads.parallelMode == ParallelMode::ABDADA
+                       && depth >= Tunables::ABDADA_DEFER_DEPTH && threads.size() > 1;
+    Move* const deferredMoves = moveLists[sPtr->ply].deferred;
+    int  nDeferred = 0, nextDeferred = 0;
+    bool pickerDone = false;
+    uint64_t moveKey = 0;
+
+    // The root searches its moves in the order of rootMoves instead: the best
+    // ones first, then the ones that took the most effort to refute so far
+    // (see RootMove::operator<). MultiPV lines only search from pvIdx on.
+    size_t nextRootMove = pvIdx;
+
+    auto nextMove = [&]() {
+        if (!pickerDone) {
+            const Move m = !RootNode                         ? mp.nextMove(skipQuiet)
+                         : nextRootMove < rootMoves.size() ? rootMoves[nextRootMove++].pv[0]
+                                                           : MOVE_NONE;
+            if (m != MOVE_NONE) return m;
+            pickerDone = true;
+        }
+        return nextDeferred < nDeferred ? deferredMoves[nextDeferred++] : MOVE_NONE;
+    };
+
     // Search all the moves, stopping if beta cutoff occurs
-    while ((currentMove = mp.nextMove(skipQuiet)) != MOVE_NONE) {
+    while ((currentMove = nextMove()) != MOVE_NONE) {
 
         assert(isValidMove(currentMove));
 
-        // At root, obey the searchmoves UCI option and skip any moves that 
-        // are not in the searchmoves list
-        if (RootNode && !rootMoves.contains(currentMove)) {
-            continue;
+        // The first move is always searched right away (young brothers wait),
+        // and deferred moves are not deferred a second time
+        if (canDefer) {
+            moveKey = SearchingTable::moveKey(pos.hash(), currentMove);
+
+            if (nMoves && !pickerDone && threads.searching.isSearching(moveKey)) {
+                deferredMoves[nDeferred++] = currentMove;
+                continue;
+            }
         }
 
         sPtr->moveCount = ++nMoves;
-        std::cout << "nMoves " << nMoves << std::endl;
 
         givesCheck = pos.givesCheck<Me>(currentMove);
         isCapture  = pos.getPieceAt(moveTo(currentMove)) != NO_PIECE;
@@ -425,7 +709,9 @@ Value SearchWorker::pvSearch(
         // Late move pruning
         if (!RootNode && bestScore > VALUE_TB_LOSS_IN_MAX_PLY) {
 
-            skipQuiet = (nMoves >= ((3 + depth * depth) / (2 - improving)));
+            const bool lmp = nMoves >= ((3 + depth * depth) / (2 - improving));
+            countStat(searchStats.lmp, lmp && !skipQuiet);
+            skipQuiet = lmp;
 
             // SEE pruning for checks / captures
             if (
@@ -433,11 +719,12 @@ Value SearchWorker::pvSearch(
              && (depth <= Tunables::SEE_PRUNING_MAX_DEPTH)
              && (!pos.see(currentMove, -depth * (isCapture ? Tunables::SEE_PRUNING_CAP_SCORE : Tunables::SEE_PRUNING_CHK_SCORE)))
             ) {
+                countStat(searchStats.seePruned);
                 continue;
             }
         }
 
-        if (RootNode && isFirstThread() && nodes > Tunables::UPDATE_NODES) {
+        if (RootNode && isFirstThread() && counters.nodes > Tunables::UPDATE_NODES) {
             Uci::callbackIter(depth, currentMove, nMoves + idx);
         }
 
@@ -446,10 +733,32 @@ Value SearchWorker::pvSearch(
         // Prefetch TT entry
         tt.prefetch(pos.hashAfter(currentMove));
 
+        const bool   isQuiet = !isCapture && moveTypeOf(currentMove) != MT_PROMOTION
+                            && moveTypeOf(currentMove) != MT_EN_PASSANT;
+        const Piece  moved   = pos.getPieceAt(moveFrom(currentMove));
+        const Square to      = moveTo(currentMove);
+
         sPtr->currentMove = currentMove;
+        sPtr->contHist    = &contHistory.at(moved, to);
+
+        // How well the move did so far, the reductions and the child's futility depend on it
+        sPtr->statScore = isQuiet ? Tunables::MOVEPICK_MAIN_HISTORY_WEIGHT * mainHistory.at(Me, currentMove)
+                                  + (*contHist[0])[moved][to] + (*contHist[1])[moved][to] + (*contHist[2])[moved][to]
+                                  - Tunables::STAT_SCORE_OFFSET
+                                  : 0;
+
+        if (isQuiet) {
+            quietsSearched[nQuiets++] = currentMove;
+        } else {
+            capturesSearched[nCaptures++] = currentMove;
+        }
+
+        const uint64_t nodesBefore = counters.nodes;
 
         // Increment nodes
-        nodes.fetch_add(1, std::memory_order_relaxed);
+        countNode();
+
+        if (canDefer) threads.searching.startSearching(moveKey);
 
         // Make the move
         pos.doMove<Me>(currentMove);
@@ -475,9 +784,11 @@ Value SearchWorker::pvSearch(
             Depth d = std::max(1, std::min(newDepth - reduction, newDepth + 1));
 
             // Narrow search with reduced depth
+            countStat(searchStats.lmrSearches);
             score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -alpha - 1, -alpha, d, true);
 
             if (score > alpha && d < newDepth) {
+                countStat(searchStats.lmrResearches);
                 // Narrow search with full depth
                 score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -alpha - 1, -alpha, newDepth - 1, !cutNode);
             }
@@ -497,13 +808,19 @@ Value SearchWorker::pvSearch(
         }
 
         // Undo the move
-        pos.undoMove(currentMove);
+        pos.undoMove<Me>(currentMove);
+
+        if (canDefer) threads.searching.finishSearching(moveKey);
+
+        if (RootNode) {
+            std::find(rootMoves.begin(), rootMoves.end(), currentMove)->nodes += counters.nodes - nodesBefore;
+        }
 
         assert(score > -VALUE_INFINITE && score < VALUE_INFINITE);
 
         // Check if the search has been aborted. If it has, this search cannot be
         // trusted fully: just return zero.
-        if (threads.shouldStop.load(std::memory_order_relaxed)) return VALUE_ZERO;
+        if (threads.shouldStop.load(std::memory_order_relaxed)) return trace.exit(VALUE_ZERO, Trace::REASON_ABORTED);
 
 
         // Check for new best move
@@ -513,6 +830,9 @@ Value SearchWorker::pvSearch(
             rm.avgScore = (rm.avgScore != -VALUE_INFINITE ? (score + rm.avgScore) / 2 : score); 
 
             if (nMoves == 1 || score > alpha) {
+                // The first move only sets the score, later ones replace the best move
+                if (nMoves > 1) ++bestMoveChanges;
+
                 rm.score = score;
                 rm.selDepth = selDepth;
 
@@ -561,9 +881,6 @@ Value SearchWorker::pvSearch(
         }
     }
 
-    std::cout << "end" << std::endl;
-    exit(0);
-
     assert (nMoves || sPtr->inCheck || Movegen::countLegalMoves<Me>(pos) == 0);
 
     // If there are no moves, we are in checkmate / stalemate
@@ -576,6 +893,14 @@ Value SearchWorker::pvSearch(
         bestScore = std::min(bestScore, maxScore);
     }
 
+    // A cutoff: reward the move, and penalise the ones that did not cut
+    if (bestScore >= beta && bestMove) {
+        updateHistories<Me>(sPtr, pos, bestMove, depth, quietsSearched, nQuiets, capturesSearched, nCaptures);
+
+        ++cutoffStats.cutoffs;
+        cutoffStats.firstMoveCutoffs += nMoves == 1;
+    }
+
     if (bestScore <= alpha) {
         // Opponent's last move was probably good
         sPtr->ttPv = sPtr->ttPv || ((sPtr - 1)->ttPv && depth > Tunables::PREVIOUS_POS_TTPV_MIN_DEPTH);
@@ -597,11 +922,74 @@ Value SearchWorker::pvSearch(
 
     assert(bestScore > -VALUE_INFINITE && bestScore < VALUE_INFINITE);
 
-    return bestScore;
+    return trace.exit(bestScore,
+        !nMoves              ? Trace::REASON_NO_MOVES
+        : bestScore >= beta  ? Trace::REASON_BETA_CUTOFF
+        : bestMove           ? Trace::REASON_EXACT
+        : Trace::REASON_FAIL_LOW,
+        bestMove, nMoves);
 
 }
 
 
+// Called on a beta cutoff. A quiet best move becomes the killer and the
+// counter move to the previous move, and gets a history bonus. A capture
+// gets a capture history bonus. The moves searched before the best one did
+// not cut off, and get the same amount as a malus.
+template<Color Me>
+void SearchWorker::updateHistories(
+    StackObject* sPtr, const Position& pos, Move bestMove, Depth depth,
+    const Move* quiets, int nQuiets, const Move* captures, int nCaptures
+) {
+    const int bonus = historyBonus(depth);
+
+    auto updateCapture = [&](Move m, int amount) {
+        const Square to = moveTo(m);
+        captureHistory.at(pos.getPieceAt(moveFrom(m)), to, typeOf(pos.getPieceAt(to))).update(amount);
+    };
+
+    auto updateQuiet = [&](Move m, int amount) {
+        const Piece  pc = pos.getPieceAt(moveFrom(m));
+        const Square to = moveTo(m);
+
+        mainHistory.at(Me, m).update(amount);
+
+        for (int i = 0; i < CONT_HIST_NB; ++i) {
+            StackObject* prev = sPtr - CONT_HIST_PLIES[i];
+            if (isValidMove(prev->currentMove)) {
+                (*prev->contHist)[pc][to].update(amount);
+            }
+        }
+    };
+
+    // The best move is the last one searched, as the loop stops on the cutoff
+    if (nQuiets && quiets[nQuiets - 1] == bestMove) {
+        sPtr->killer = bestMove;
+
+        const Move prevMove = (sPtr - 1)->currentMove;
+        if (isValidMove(prevMove)) {
+            counterMoves.at(pos.getPieceAt(moveTo(prevMove)), moveTo(prevMove)) = bestMove;
+        }
+
+        updateQuiet(bestMove, bonus);
+        --nQuiets;
+    } else {
+        assert(nCaptures && captures[nCaptures - 1] == bestMove);
+
+        updateCapture(bestMove, bonus);
+        --nCaptures;
+    }
+
+    for (int i = 0; i < nQuiets; ++i) {
+        updateQuiet(quiets[i], -bonus);
+    }
+
+    for (int i = 0; i < nCaptures; ++i) {
+        updateCapture(captures[i], -bonus);
+    }
+}
+
+
 // Quiescense search function, called by main search with depth 0.
 // This recursively searches moves on the search horizon, to ensure
 // that the static evaluation is not confused by tactical moves and misjudges
@@ -617,7 +1005,7 @@ Value SearchWorker::qSearch(
     assert(PvNode || (alpha == beta - 1));
     assert(depth <= 0);
 
-    Move pv[MAX_PLY + 1];
+    Move* const pv = pvLines[sPtr->ply + 1].data();
 
     Value score, bestScore, eval;
     Move currentMove, bestMove;
@@ -628,6 +1016,14 @@ Value SearchWorker::qSearch(
         sPtr->pv[0] = MOVE_NONE;
     }
 
+    Trace::NodeTrace trace(tracer, pos.hash(), sPtr->ply, depth, alpha, beta,
+                           PvNode ? Trace::NODE_QSEARCH_PV : Trace::NODE_QSEARCH_NON_PV, (sPtr - 1)->currentMove);
+
+    // See if search has been aborted
+    if (threads.shouldStop.load(std::memory_order_relaxed)) {
+        return trace.exit(VALUE_ZERO, Trace::REASON_ABORTED);
+    }
+
     bestMove = MOVE_NONE;
     sPtr->inCheck = pos.inCheck();
 
@@ -636,15 +1032,18 @@ Value SearchWorker::qSearch(
     }
 
     if (pos.isDraw() || sPtr->ply >= MAX_PLY) {
-        return (sPtr->ply >= MAX_PLY && !sPtr->inCheck)
-          ? Eval::evaluate<Me>(pos, networks, cacheTable)
-          : VALUE_DRAW;
+        return trace.exit((sPtr->ply >= MAX_PLY && !sPtr->inCheck)
+          ? evaluate<Me>(pos)
+          : VALUE_DRAW, Trace::REASON_DRAW);
     }
 
     assert(0 <= sPtr->ply && sPtr->ply < MAX_PLY);
 
-    auto [ttHit, ttData, ttWriter] = tt.probe(pos.hash());
+    TranspositionTable& qsTT = qsearchTT();
+
+    auto [ttHit, ttData, ttWriter] = qsTT.probe(pos.hash());
     sPtr->ttHit  = ttHit;
+    updateTTStats<Me>(qtt.empty() ? ttStats : qttStats, pos, ttHit, ttData.move);
     ttData.move  = ttHit  ? ttData.move : MOVE_NONE;
     ttData.score = ttHit ? ttData.getAdjustedScore(sPtr->ply) : VALUE_NONE;
 
@@ -654,14 +1053,13 @@ Value SearchWorker::qSearch(
      && ttData.depth >= (sPtr->inCheck || depth >= QSEARCH_DEPTH_CHECKS ? QSEARCH_DEPTH_CHECKS : QSEARCH_DEPTH_NORMAL)
      && (ttData.bound & (ttData.score >= beta ? BOUND_LOWER : BOUND_UPPER))
     ) {
-        return ttData.score;
+        return trace.exit(ttData.score, Trace::REASON_TT_CUTOFF, ttData.move);
     }
 
     // Static eval of position
     if (!sPtr->inCheck) {
         if (sPtr->ttHit) {
-            eval = Eval::evaluate<Me>(pos, networks, cacheTable);
-            sPtr->staticEval = bestScore = (ttData.eval != VALUE_NONE ? ttData.eval : clampEval(eval));
+            sPtr->staticEval = bestScore = (ttData.eval != VALUE_NONE ? ttData.eval : clampEval(evaluate<Me>(pos)));
 
             // Use value from tt if possible
             if (std::abs(ttData.score) < VALUE_TB_WIN_IN_MAX_PLY
@@ -671,10 +1069,12 @@ Value SearchWorker::qSearch(
             }
 
         } else {
-            eval = Eval::evaluate<Me>(pos, networks, cacheTable);
+            eval = evaluate<Me>(pos);
             sPtr->staticEval = bestScore = (ttData.eval != VALUE_NONE ? ttData.eval : clampEval(eval));
         }
 
+        trace.setEval(sPtr->staticEval);
+
         // If static eval is at least beta, return immediately
         if (bestScore >= beta) {
             if (std::abs(bestScore) < VALUE_TB_WIN_IN_MAX_PLY && !PvNode) {
@@ -689,12 +1089,12 @@ Value SearchWorker::qSearch(
                     -2,
                     false,
                     MOVE_NONE,
-                    tt.getAge(),
+                    qsTT.getAge(),
                     BOUND_LOWER
                 );
             }
 
-            return bestScore;
+            return trace.exit(bestScore, Trace::REASON_STAND_PAT);
         }
 
         if (bestScore > alpha) {
@@ -706,7 +1106,13 @@ Value SearchWorker::qSearch(
     }
 
 
-    Movepicker::MovePicker<Me> mp(pos, ttData.move, sPtr->killer, depth);
+    const PieceToHistory* contHist[CONT_HIST_NB];
+    for (int i = 0; i < CONT_HIST_NB; ++i) {
+        contHist[i] = (sPtr - CONT_HIST_PLIES[i])->contHist;
+    }
+
+    Movepicker::MovePicker<Me> mp(pos, ttData.move, sPtr->killer, MOVE_NONE, depth, mainHistory, captureHistory, contHist,
+                                  moveLists[sPtr->ply].picker);
 
 
     while ((currentMove = mp.nextMove()) != MOVE_NONE) {
@@ -720,18 +1126,21 @@ Value SearchWorker::qSearch(
         }
 
         // Prefetch probable tt entry early
-        tt.prefetch(pos.hashAfter(currentMove));
+        qsTT.prefetch(pos.hashAfter(currentMove));
 
         sPtr->currentMove = currentMove;
 
         // Increment nodes
-        nodes.fetch_add(1, std::memory_order_relaxed);
+        countNode();
 
         // Recursive part
         pos.doMove<Me>(currentMove);
         score = -qSearch<~Me, nodeType>(pos, sPtr + 1, -beta, -alpha, depth - 1);
         pos.undoMove<Me>(currentMove);
 
+        // Do not count any more nodes once stopped, node limits are exact
+        if (threads.shouldStop.load(std::memory_order_relaxed)) return trace.exit(VALUE_ZERO, Trace::REASON_ABORTED);
+
         if (score > bestScore) {
             bestScore = score;
 
@@ -754,7 +1163,7 @@ Value SearchWorker::qSearch(
 
     // Check for checkmate (we are in check and the best score has not been changed)
     if (sPtr->inCheck && bestScore == -VALUE_INFINITE) {
-        return -VALUE_MATE + sPtr->ply;
+        return trace.exit(-VALUE_MATE + sPtr->ply, Trace::REASON_NO_MOVES);
     }
 
     if (std::abs(bestScore) < VALUE_TB_WIN_IN_MAX_PLY && bestScore >= beta) {
@@ -769,13 +1178,17 @@ Value SearchWorker::qSearch(
         depth,
         ttHit && ttData.isPv,
         bestMove,
-        tt.getAge(),
+        qsTT.getAge(),
         bestScore > beta ? BOUND_LOWER : BOUND_UPPER
     );
 
     assert(bestScore > -VALUE_INFINITE && bestScore < VALUE_INFINITE);
 
-    return bestScore;
+    return trace.exit(bestScore,
+        bestScore >= beta ? Trace::REASON_BETA_CUTOFF
+        : bestMove        ? Trace::REASON_EXACT
+        : Trace::REASON_FAIL_LOW,
+        bestMove, nMoves);
 }
 
 
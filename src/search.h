@@ -1,15 +1,22 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <span>
 #include <string_view>
 #include <vector>
 
+#include "evaluate.h"
+#include "history.h"
+#include "mate.h"
 #include "movegen.h"
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
+#include "trace.h"
 #include "tt.h"
 #include "tunables.h"
 #include "types.h"
@@ -25,6 +32,13 @@ inline TimePoint now() {
       .count();
 }
 
+// Microsecond timer, used to measure thread pool latency
+inline int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
 
 // Declare these here: they are defined in thread.h
 class ThreadPool;
@@ -68,9 +82,10 @@ inline void updatePv(Move* pv, Move currentMove, const Move* childPv) {
 struct SearchInfo {
     int depth;
     int selDepth;
+    size_t multiPV;
     size_t timeSearched;
     size_t nodesSearched;
-    std::string_view pv;
+    std::span<const Move> pv;
     std::string_view score;
     int hashFull;
     size_t tbHits;
@@ -82,14 +97,15 @@ struct SearchLimits {
     SearchLimits() {
         time[WHITE] = time[BLACK] = TimePoint(0);
         inc[WHITE]  = inc[BLACK]  = TimePoint(0);
-        isInfinite = false;
+        startTimePoint = moveTime = TimePoint(0);
+        isInfinite = ponder = false;
         nodes = depth = mate = movesToGo = 0;
     }
 
     std::vector<std::string> searchMoves;
     TimePoint time[COLOR_NB], inc[COLOR_NB];
     TimePoint startTimePoint, moveTime;
-    bool isInfinite;
+    bool isInfinite, ponder;
     uint64_t nodes;
     int depth, mate, movesToGo;
 };
@@ -99,16 +115,22 @@ struct SearchWorkerShared {
     SearchWorkerShared(
         ThreadPool& threadPool,
         NNUE::Networks& NNUEs,
-        TranspositionTable& tt
+        TranspositionTable& tt,
+        TranspositionTable& qtt,
+        Mate::MateTable& mateTable
     ) :
         threads(threadPool),
         networks(NNUEs),
-        tt(tt)
+        tt(tt),
+        qtt(qtt),
+        mateTable(mateTable)
     {}
 
     ThreadPool&             threads;
     const NNUE::Networks&   networks;
     TranspositionTable&     tt;
+    TranspositionTable&     qtt;  // Quiescence search table (may be empty)
+    Mate::MateTable&        mateTable;
 };
 
 
@@ -122,8 +144,13 @@ struct RootMove {
 
     bool operator== (const Move& m) const { return pv[0] == m; }
     bool operator== (const RootMove& rm) const { return pv[0] == rm.pv[0]; }
+    // Best score first. The moves that did not raise alpha all score
+    // -VALUE_INFINITE: the ones that took more nodes to refute come first, as
+    // they are the most likely to become the best move.
     bool operator<  (const RootMove& rm) const {
-        return rm.score == score ? rm.prevScore < prevScore : rm.score < score;
+        return rm.score     != score     ? rm.score < score
+             : rm.prevScore != prevScore ? rm.prevScore < prevScore
+             : rm.nodes < nodes;
     }
 
     Value score     = -VALUE_INFINITE;
@@ -131,12 +158,22 @@ struct RootMove {
     Value avgScore  = -VALUE_INFINITE;
     Value uciScore  = -VALUE_INFINITE;
     Depth selDepth  = 0;
+    uint64_t nodes  = 0;  // Nodes spent searching this move, over all iterations
     MoveList pv;
 };
 
 using RootMoveList = ValueList<RootMove, MAX_MOVE>;
 
 
+// Stable insertion sort of the root moves. Unlike std::stable_sort it does
+// not allocate a buffer, and the moves are mostly in order already.
+inline void sortRootMoves(RootMove* begin, RootMove* end) {
+    for (RootMove* rm = begin; rm != end; ++rm) {
+        std::rotate(std::upper_bound(begin, rm, *rm), rm, rm + 1);
+    }
+}
+
+
 enum NodeType {
     NODETYPE_PV,
     NODETYPE_NON_PV,
@@ -144,8 +181,89 @@ enum NodeType {
 };
 
 
+// Node and tbhit counters of one worker. The worker counts in the plain
+// integers and only copies them to the atomics at each checkup, at most every
+// COUNTER_PUBLISH_INTERVAL nodes, other threads only ever read the atomics.
+// Each half has its own cache line, so the readers never pull the line the
+// worker writes to.
+constexpr uint64_t COUNTER_PUBLISH_INTERVAL = 1024;
+
+struct SearchCounters {
+    alignas(NNUE::CacheLineSize) uint64_t nodes, tbHits;
+    uint64_t checkupCountdown;  // Nodes left until the next checkup
+    alignas(NNUE::CacheLineSize) std::atomic<uint64_t> publishedNodes, publishedTbHits;
+};
+
+
+// Beta cutoffs in the main search, and how many of them came from the first
+// move searched: a measure of the move ordering.
+struct CutoffStats {
+    uint64_t cutoffs          = 0;
+    uint64_t firstMoveCutoffs = 0;
+
+    inline CutoffStats& operator+=(const CutoffStats& other) {
+        cutoffs          += other.cutoffs;
+        firstMoveCutoffs += other.firstMoveCutoffs;
+        return *this;
+    }
+};
+
+
+// Counters of how often each search heuristic fires, used to tune the
+// parameters in tunables.h. They are only kept in builds made with
+// SEARCH_STATS=yes (see Makefile): otherwise countStat compiles to nothing.
+#if defined(SEARCH_STATS)
+constexpr bool SEARCH_STATS_ENABLED = true;
+#else
+constexpr bool SEARCH_STATS_ENABLED = false;
+#endif
+
+struct SearchStats {
+    uint64_t rfp                  = 0;
+    uint64_t razoringTries        = 0, razoringCuts = 0;
+    uint64_t futility             = 0;
+    uint64_t nmpTries             = 0, nmpCuts = 0;
+    uint64_t nmpVerifications     = 0, nmpVerificationFails = 0;
+    uint64_t probcutTries         = 0, probcutCuts = 0;
+    uint64_t lmp                  = 0;  // Nodes where late move pruning started
+    uint64_t seePruned            = 0;
+    uint64_t lmrSearches          = 0, lmrResearches = 0;
+    uint64_t aspirationFailLows   = 0, aspirationFailHighs = 0;
+    std::array<uint64_t, MAX_PLY> iterationNodes = {};  // Nodes of each completed iteration, by depth
+
+    inline SearchStats& operator+=(const SearchStats& other) {
+        rfp                  += other.rfp;
+        razoringTries        += other.razoringTries;
+        razoringCuts         += other.razoringCuts;
+        futility             += other.futility;
+        nmpTries             += other.nmpTries;
+        nmpCuts              += other.nmpCuts;
+        nmpVerifications     += other.nmpVerifications;
+        nmpVerificationFails += other.nmpVerificationFails;
+        probcutTries         += other.probcutTries;
+        probcutCuts          += other.probcutCuts;
+        lmp                  += other.lmp;
+        seePruned            += other.seePruned;
+        lmrSearches          += other.lmrSearches;
+        lmrResearches        += other.lmrResearches;
+        aspirationFailLows   += other.aspirationFailLows;
+        aspirationFailHighs  += other.aspirationFailHighs;
+
+        for (size_t d = 0; d < iterationNodes.size(); ++d) {
+            iterationNodes[d] += other.iterationNodes[d];
+        }
+        return *this;
+    }
+};
+
+
+// Number of stack entries before the root, enough for the oldest
+// continuation history (see CONT_HIST_PLIES)
+constexpr int STACK_OFFSET = 4;
+
 struct StackObject {
     Move*   pv;
+    PieceToHistory* contHist;  // Continuation history of currentMove
     int     ply;
     Value   staticEval;
     Move    currentMove;
@@ -156,19 +274,31 @@ struct StackObject {
 };
 
 
+// Move lists of a node being searched (see SearchWorker::moveLists)
+struct NodeMoveLists {
+    ScoredMove picker[MAX_MOVE];    // Sorted by the move picker
+    Move       quiets[MAX_MOVE];    // Searched so far, for the history updates
+    Move       captures[MAX_MOVE];
+    Move       deferred[MAX_MOVE];  // Put aside by ABDADA
+};
+
+
 class SearchWorker {
 public:
     void clear();
+    void initReductions(size_t nbThreads);
 
+    // The accumulator caches are cleared by their own constructor, and the
+    // reductions are set by the thread pool once it knows its final size.
     SearchWorker(SearchWorkerShared& sharedState, size_t idx) :
         idx(idx),
         threads(sharedState.threads),
         tt(sharedState.tt),
+        qtt(sharedState.qtt),
+        mateTable(sharedState.mateTable),
         networks(sharedState.networks),
         cacheTable(networks)
-    {
-        clear();
-    }
+    {}
 
     void onNewPv(
         SearchWorker& bestWorker,
@@ -178,11 +308,18 @@ public:
     );
 
     void startSearch();
+    void onNewSearch();
     inline bool isFirstThread() const { return idx == 0; }
     inline RootMove getRootMove(const int i) const { return rootMoves[i]; }
 
-    inline uint64_t getNodes()  const { return nodes.load(std::memory_order_relaxed);  }
-    inline uint64_t getTbHits() const { return tbHits.load(std::memory_order_relaxed); }
+    inline uint64_t getNodes()  const { return counters.publishedNodes.load(std::memory_order_relaxed);  }
+    inline uint64_t getTbHits() const { return counters.publishedTbHits.load(std::memory_order_relaxed); }
+    inline Depth    getCompletedDepth() const { return completedDepth; }
+    inline TTStats  getTTStats()  const { return ttStats;  }
+    inline TTStats  getQTTStats() const { return qttStats; }
+    inline Eval::EvalCacheStats getEvalCacheStats() const { return evalCacheStats; }
+    inline CutoffStats getCutoffStats() const { return cutoffStats; }
+    inline const SearchStats& getSearchStats() const { return searchStats; }
 
     Search::SearchLimits limits;
     Position rootPosition;
@@ -211,6 +348,16 @@ private:
     );
 
 
+    // Proof-number search for go mate, see mate.cpp
+    bool solveMate();
+
+    template<Color Me, bool Attacker>
+    void mateSearch(Position& pos, int movesLeft, uint32_t thPhi, uint32_t thDelta, int ply);
+
+    template<Color Me>
+    void matePv(Position& pos, int movesLeft, MoveList& pv);
+
+
     inline int getReduction(bool improving, Depth depth, int moveCount, int delta) {
         int scale = reductions[depth] * reductions[moveCount];
         return (
@@ -220,19 +367,118 @@ private:
     }
 
 
+    template<Color Me>
+    void updateHistories(
+        StackObject* sPtr, const Position& pos, Move bestMove, Depth depth,
+        const Move* quiets, int nQuiets, const Move* captures, int nCaptures
+    );
+
+
+    // Lazy SMP depth schedule of the helpers, see Tunables::SMP_SKIP_SIZE
+    inline bool skipDepth(Depth depth) const {
+
+        const size_t pattern = (idx - 1) % Tunables::SMP_SKIP_PATTERNS;
+        return ((depth + Tunables::SMP_SKIP_PHASE[pattern]) / Tunables::SMP_SKIP_SIZE[pattern]) % 2;
+    }
+
+
+    inline void countNode() {
+        ++counters.nodes;
+
+        if (--counters.checkupCountdown == 0) {
+            checkup();
+        }
+    }
+
+    void checkup();
+    void scheduleCheckup();
+
+    inline void publishCounters() {
+        counters.publishedNodes.store(counters.nodes, std::memory_order_relaxed);
+        counters.publishedTbHits.store(counters.tbHits, std::memory_order_relaxed);
+    }
+
+
+    inline void countStat(uint64_t& counter, uint64_t n = 1) {
+        if constexpr (SEARCH_STATS_ENABLED) {
+            counter += n;
+        }
+    }
+
+
+    // Static evaluation of the position, looked up in the eval cache first
+    template<Color Me>
+    inline Value evaluate(const Position& pos) {
+        Value eval;
+
+        ++evalCacheStats.probes;
+        if (evalCache.probe(pos.hash(), eval)) {
+            ++evalCacheStats.hits;
+            return eval;
+        }
+
+        eval = Eval::evaluate<Me>(pos, networks, cacheTable);
+        evalCache.store(pos.hash(), eval);
+        return eval;
+    }
+
+
+    // Quiescence search uses its own table when one has been allocated,
+    // so that it does not evict the deeper entries of the main search.
+    inline TranspositionTable& qsearchTT() { return qtt.empty() ? tt : qtt; }
+
+
+    // Bookkeeping for TT benchmarking (see TTStats)
+    template<Color Me>
+    inline void updateTTStats(TTStats& stats, const Position& pos, bool ttHit, Move ttMove) {
+        ++stats.probes;
+        if (ttHit) {
+            ++stats.hits;
+            stats.collisions += ttMove != MOVE_NONE && !pos.isPseudoLegalMove<Me>(ttMove);
+        }
+    }
+
+
     size_t   idx;
 
     Depth    currentDepth, searchDepth, completedDepth, selDepth, nmpCutoff;
+    size_t   multiPV, pvIdx;  // Number of lines to search, and the current one
     Value    rootDelta;
 
-    std::array<int, MAX_MOVE> reductions;
+    // Time management signals, only used by the first thread
+    int      bestMoveChanges;
+    double   totBestMoveChanges;
+
+    std::array<int, MAX_MOVE> reductions = {};
+
+    // Per ply buffers, kept here rather than in the search frames so that the
+    // recursion stays small. Only one node per ply is being searched at a
+    // time: the node at ply p builds its PV in pvLines[p], from the line its
+    // children leave in pvLines[p + 1], and keeps its moves in moveLists[p].
+    std::array<std::array<Move, MAX_PLY + 1>, MAX_PLY + 2> pvLines;
+    std::array<NodeMoveLists, MAX_PLY + 1>                 moveLists;
+
+    // Move ordering statistics, kept from one search to the next
+    ButterflyHistory    mainHistory;
+    CaptureHistory      captureHistory;
+    ContinuationHistory contHistory;
+    CounterMoveTable    counterMoves;
 
     ThreadPool&             threads;
     TranspositionTable&     tt;
+    TranspositionTable&     qtt;
+    Mate::MateTable&        mateTable;
     const NNUE::Networks&   networks;
     NNUE::AccumulatorCaches cacheTable;
+    Eval::EvalCache         evalCache;
+
+    SearchCounters counters;
+    TTStats ttStats, qttStats;
+    Eval::EvalCacheStats evalCacheStats;
+    CutoffStats cutoffStats;
+    SearchStats searchStats;
 
-    std::atomic<uint64_t> nodes, tbHits;
+    Trace::Tracer tracer;  // Only records anything with SEARCH_TRACE, see trace.h
 
 };
 
@@ -1,61 +1,106 @@
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstdlib>
 #include <memory>
-#include <mutex>
+#include <utility>
 
 #include "thread.h"
+#include "alloccount.h"
 #include "movegen.h"
+#include "numa.h"
 #include "search.h"
 #include "types.h"
 
 namespace Atom {
 
+Thread::Thread(
+    size_t index,
+    Search::SearchWorkerShared& sharedState,
+    bool bindThread
+) :
+    idx(index),
+    pool(sharedState.threads),
+    thread(&Thread::run, this, std::ref(sharedState), bindThread)
+{}
+
+
+// Entry point of the thread. The worker is created here rather than in the
+// constructor so that, once the thread is pinned, its memory is first touched
+// (and so allocated) on the thread's own NUMA node.
+void Thread::run(Search::SearchWorkerShared& sharedState, bool bindThread) {
+    if (bindThread) {
+        Numa::bindThisThread(idx);
+    }
+
+    worker = std::make_unique<Search::SearchWorker>(sharedState, idx);
+
+    idle();
+}
+
+
+// Only called while the pool is idle. When several threads are removed at
+// once, the pool wakes them all up together before destroying them.
 Thread::~Thread() {
-    shouldExit = true;
-    search();
+    if (!shouldExit) {
+        shouldExit = true;
+        pool.startTask(ThreadTask::NONE);
+    }
     thread.join();
 }
 
-void Thread::search() {
-    std::unique_lock<std::mutex> lock(mutex);
-    cv.wait(lock, [&] { return !searching; });
-    searching = true;
 
-    worker->startSearch();
-
-    cv.notify_one();
-}
+// Sleeps until the pool hands out a new task, runs it, and goes back to sleep.
+void Thread::idle() {
+    // Read the epoch before reporting that the worker has been created:
+    // the pool can not start a task until then, so no task is missed.
+    uint64_t seenEpoch = pool.epoch.load(std::memory_order_acquire);
+    pool.onTaskFinished();
 
+    while (true) {
+        pool.epoch.wait(seenEpoch, std::memory_order_acquire);
+        seenEpoch = pool.epoch.load(std::memory_order_acquire);
 
-void Thread::clear() {
-    std::unique_lock<std::mutex> lock(mutex);
-    cv.wait(lock, [&] { return !searching; });
-    searching = true;
+        if (shouldExit) return;
 
-    worker->clear();
+        switch (ThreadTask(seenEpoch & EPOCH_TASK_MASK)) {
+            case ThreadTask::SEARCH:
+                worker->startSearch();
+                break;
+            case ThreadTask::CLEAR:
+                worker->clear();
+                break;
+            default:
+                continue;
+        }
 
-    cv.notify_one();
+        pool.onTaskFinished();
+    }
 }
 
 
-void Thread::idle() {
-    while (true) {
-        searching = false;
-        std::unique_lock<std::mutex> lock(mutex);
-        cv.notify_one();
-        // Wait until some other thread starts searching
-        cv.wait(lock, [&] { return searching; });
+ThreadPool::~ThreadPool() {
+    waitForFinish();
+    removeThreads(0);
+}
 
-        if (shouldExit) return;
 
-        lock.unlock();
+// Releases every thread at once to run the given task.
+// Should only be called by the UCI thread, while the pool is idle.
+void ThreadPool::startTask(ThreadTask task) {
+    if (task != ThreadTask::NONE) {
+        nbRunning.store(threads.size(), std::memory_order_relaxed);
     }
+
+    const uint64_t counter = (epoch.load(std::memory_order_relaxed) >> EPOCH_TASK_BITS) + 1;
+    epoch.store((counter << EPOCH_TASK_BITS) | uint64_t(task), std::memory_order_release);
+    epoch.notify_all();
 }
 
 
-void Thread::waitForFinish() {
-    std::unique_lock<std::mutex> lock(mutex);
-    // Wait until other threads are no longer searching
-    cv.wait(lock, [&]{ return !searching; });
+void ThreadPool::onTaskFinished() {
+    nbRunning.fetch_sub(1, std::memory_order_acq_rel);
+    nbRunning.notify_all();
 }
 
 
@@ -64,43 +109,78 @@ void ThreadPool::go(
     Search::SearchLimits limits
 ) {
 
-    firstThread()->waitForFinish();
+    waitForFinish();
+
+    goTime = nowMicros();
+    firstNodeTime = allStartedTime = stopTime = bestMoveTime = 0;
+    nbStarted = 0;
+
+    shouldStop  = false;
+    abortSearch = false;
 
-    Search::RootMoveList rootMoves;
+    ponder          = limits.ponder;
+    stopOnPonderhit = false;
 
+    rootMoves.clear();
     Movegen::enumerateLegalMoves(pos, [&](Move m) {
         rootMoves.push_back(Search::RootMove(m));
         return true;
     });
 
+    pos.takeSnapshot(rootSnapshot);
+    searchLimits = limits;
+    timeManager.init(limits, pos.getSideToMove());
+
     for (std::unique_ptr<Thread>& thread : threads) {
-        thread->waitForFinish();
-        thread->setupWorker(pos, rootMoves, limits);
+        thread->worker->onNewSearch();
     }
 
-    // Start first thread searching, this will notify the others.
-    firstThread()->search();
+    AllocCount::reset();
+    startTask(ThreadTask::SEARCH);
+}
+
+
+// Tells every thread to stop searching. Does not wait for them to finish.
+void ThreadPool::stop() {
+    int64_t expected = 0;
+    stopTime.compare_exchange_strong(expected, nowMicros());
 
+    shouldStop = true;
+    shouldStop.notify_all();
 }
 
 
-// Start all threads searching.
-// This should only be invoked once, by the main thread.
-void ThreadPool::startSearching() {
+// The opponent played the expected move. The running search carries on, now
+// on our clock, or stops right away if it would have stopped while pondering.
+void ThreadPool::ponderhit() {
+    timeManager.onPonderhit();
+    ponder = false;
 
-    for (std::unique_ptr<Thread>& thread : threads) {
-        // First thread has called all the other threads: it is
-        // already searching. Call all other threads.
-        if (!(thread->id() == 0)) {
-            thread->search();
-        }
+    if (stopOnPonderhit) {
+        stop();
     }
 }
 
 
+// Blocks until stop() is called.
+void ThreadPool::waitForStop() {
+    shouldStop.wait(false);
+}
+
+
+// Blocks until every thread but the first has finished its task.
+// Should only be called by the first thread.
+void ThreadPool::waitForHelpers() {
+    for (size_t n; (n = nbRunning.load(std::memory_order_acquire)) > 1; ) {
+        nbRunning.wait(n);
+    }
+}
+
+
+// Blocks until every thread has finished its task.
 void ThreadPool::waitForFinish() {
-    for (std::unique_ptr<Thread>& thread : threads) {
-        if (thread != threads.front()) thread->waitForFinish();
+    for (size_t n; (n = nbRunning.load(std::memory_order_acquire)) != 0; ) {
+        nbRunning.wait(n);
     }
 }
 
@@ -108,53 +188,128 @@ void ThreadPool::waitForFinish() {
 void ThreadPool::clearThreads() {
     if (threads.size() == 0) return;
 
-    for (std::unique_ptr<Thread>& thread: threads) {
-        thread->clear();
-        thread->waitForFinish();
-    }
+    waitForFinish();
+    startTask(ThreadTask::CLEAR);
+    waitForFinish();
+
+    searching.clear();
 }
 
 
-void ThreadPool::setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState) {
+// Changes the number of threads. Only the difference is created or destroyed:
+// existing threads keep their worker, and so their allocated and already
+// cleared caches. All threads are only recreated when the thread binding
+// changes, as a thread is pinned when it starts.
+void ThreadPool::setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState, bool bindThreads) {
+    nbThreads = std::min(nbThreads, MAX_THREADS);
+
     // Wait for existing threads to finish
-    if (!threads.empty()) {
-        firstThread()->waitForFinish();
-        threads.clear();
+    waitForFinish();
+
+    if (bindThreads != threadsBound) {
+        removeThreads(0);
+        threadsBound = bindThreads;
     }
 
-    if (nbThreads <= 0) {
-        return;
+    if (nbThreads < threads.size()) {
+        removeThreads(nbThreads);
+    } else if (nbThreads > threads.size()) {
+        // Each new thread reports back once its worker has been created
+        nbRunning = nbThreads - threads.size();
+
+        for (size_t i = threads.size(); i < nbThreads; ++i) {
+            threads.emplace_back(std::make_unique<Thread>(i, sharedState, bindThreads));
+        }
+
+        waitForFinish();
     }
 
-    for (size_t i = 0; i < nbThreads; ++i) {
-        threads.emplace_back(std::make_unique<Thread>(i, sharedState));
+    // Reductions depend on the number of threads
+    for (std::unique_ptr<Thread>& thread : threads) {
+        thread->worker->initReductions(threads.size());
     }
 }
 
 
+// Destroys every thread from index nbThreads on, waking them all with a
+// single epoch change instead of one per thread.
+void ThreadPool::removeThreads(size_t nbThreads) {
+    if (nbThreads >= threads.size()) return;
+
+    for (size_t i = nbThreads; i < threads.size(); ++i) {
+        threads[i]->shouldExit = true;
+    }
+
+    startTask(ThreadTask::NONE);
+    threads.resize(nbThreads);
+}
+
+
 Thread* ThreadPool::bestThread() const {
 
-    Thread* bestThread = firstThread();
+    // Threads that have not completed a depth have nothing to vote with
+    auto hasVote = [](const Search::SearchWorker& w) { return w.getCompletedDepth() > 0; };
 
-    for (const std::unique_ptr<Thread>& newThread : threads) {
-        const Value maxScore = bestThread->worker->getRootMove(0).score;
-        const Depth maxDepth = bestThread->worker->getRootMove(0).selDepth;
+    Value minScore = VALUE_INFINITE;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        if (hasVote(*thread->worker)) {
+            minScore = std::min(minScore, thread->worker->rootMoves[0].score);
+        }
+    }
 
-        const Value newScore = newThread->worker->getRootMove(0).score;
-        const Depth newDepth = newThread->worker->getRootMove(0).selDepth;
+    // Every thread votes for its best move, with a weight growing with both its
+    // score and its completed depth. There are few distinct best moves, so
+    // they are kept in a list rather than a map, which would allocate.
+    ValueList<std::pair<Move, int64_t>, MAX_MOVE> votes;
 
-        // If thread has an equal depth and greater score (or possible mate) it is better.
-        if ((newScore > maxScore)
-        &&  (newDepth == maxDepth || newScore > VALUE_MATE_IN_MAX_PLY)) {
-            bestThread = newThread.get();
+    auto voteSlot = [&](Move move) -> std::pair<Move, int64_t>* {
+        const auto it = std::find_if(votes.begin(), votes.end(), [&](const auto& v) { return v.first == move; });
+        return it != votes.end() ? it : nullptr;
+    };
+
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        const Search::SearchWorker& w = *thread->worker;
+        if (!hasVote(w)) continue;
+
+        const Move move = w.rootMoves[0].pv[0];
+        auto* slot = voteSlot(move);
+        if (!slot) {
+            votes.push_back({move, 0});
+            slot = votes.end() - 1;
         }
+        slot->second += int64_t(w.rootMoves[0].score - minScore + Tunables::SMP_VOTE_SCORE_OFFSET) * w.getCompletedDepth();
+    }
+
+    auto votesFor = [&](Move move) {
+        const auto* slot = voteSlot(move);
+        return slot ? slot->second : 0;
+    };
 
-        // If thread has a greater depth + score (without replacing a closer mate) it is better.
-        if ((newDepth > maxDepth)
-        && (newScore > maxScore || maxScore < VALUE_MATE_IN_MAX_PLY)) {
+    Thread* bestThread = firstThread();
+    int64_t bestVotes  = votesFor(bestThread->worker->rootMoves[0].pv[0]);
+
+    for (const std::unique_ptr<Thread>& newThread : threads) {
+        const Search::SearchWorker& w = *newThread->worker;
+        if (!hasVote(w)) continue;
+
+        const Value bestScore = bestThread->worker->rootMoves[0].score;
+        const Value newScore  = w.rootMoves[0].score;
+        const int64_t newVotes = votesFor(w.rootMoves[0].pv[0]);
+
+        // Once a mate or TB result has been found, prefer the shortest one.
+        // Otherwise the most voted move wins, ties broken by score, but never
+        // pick a thread that thinks it is getting mated.
+        if (std::abs(bestScore) >= VALUE_TB_WIN_IN_MAX_PLY) {
+            if (newScore > bestScore) {
+                bestThread = newThread.get();
+                bestVotes  = newVotes;
+            }
+        } else if (newScore >= VALUE_TB_WIN_IN_MAX_PLY
+               || (newScore > VALUE_TB_LOSS_IN_MAX_PLY
+                   && (newVotes > bestVotes || (newVotes == bestVotes && newScore > bestScore)))) {
             bestThread = newThread.get();
+            bestVotes  = newVotes;
         }
-
     }
 
     return bestThread;
@@ -178,4 +333,84 @@ uint64_t ThreadPool::totalTbHits() const {
     return sum;
 }
 
+
+TTStats ThreadPool::totalTTStats() const {
+    TTStats sum;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getTTStats();
+    }
+    return sum;
+}
+
+
+TTStats ThreadPool::totalQTTStats() const {
+    TTStats sum;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getQTTStats();
+    }
+    return sum;
+}
+
+
+Eval::EvalCacheStats ThreadPool::totalEvalCacheStats() const {
+    Eval::EvalCacheStats sum;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getEvalCacheStats();
+    }
+    return sum;
+}
+
+
+Search::CutoffStats ThreadPool::totalCutoffStats() const {
+    Search::CutoffStats sum;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getCutoffStats();
+    }
+    return sum;
+}
+
+
+Search::SearchStats ThreadPool::totalSearchStats() const {
+    Search::SearchStats sum;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getSearchStats();
+    }
+    return sum;
+}
+
+
+void ThreadPool::onSearchStarted() {
+    const int64_t t = nowMicros();
+
+    int64_t expected = 0;
+    firstNodeTime.compare_exchange_strong(expected, t);
+
+    if (nbStarted.fetch_add(1) + 1 == threads.size()) {
+        allStartedTime = t;
+    }
+}
+
+
+void ThreadPool::onBestMove(Move bestMove) {
+    bestMoveTime = nowMicros();
+
+    agreement = {bestMove, 0, 0};
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        const Search::SearchWorker& w = *thread->worker;
+        if (w.getCompletedDepth() > 0) {
+            ++agreement.nbVoting;
+            agreement.nbAgreeing += w.rootMoves[0].pv[0] == bestMove;
+        }
+    }
+}
+
+
+SearchLatency ThreadPool::getLatency() const {
+    return SearchLatency{
+        .goToFirstNode  = firstNodeTime  - goTime,
+        .goToAllStarted = allStartedTime - goTime,
+        .stopToBestMove = bestMoveTime   - stopTime,
+    };
+}
+
 } // namespace Atom
@@ -2,64 +2,80 @@
 #define THREAD_H
 
 #include <atomic>
-#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "abdada.h"
 #include "search.h"
+#include "timeman.h"
 
 namespace Atom {
 
 constexpr size_t NB_THREADS_DEFAULT = 1;
+constexpr size_t MAX_THREADS        = 1024;
+
+class ThreadPool;
+
+
+// Tasks that the thread pool can hand to all of its threads at once.
+enum class ThreadTask : uint64_t {
+    NONE,
+    SEARCH,
+    CLEAR
+};
+
+// The task is stored in the low bits of the thread pool epoch
+constexpr uint64_t EPOCH_TASK_BITS = 2;
+constexpr uint64_t EPOCH_TASK_MASK = (1 << EPOCH_TASK_BITS) - 1;
+
+
+// Latencies of the last search, in microseconds. Used for benchmarking.
+struct SearchLatency {
+    int64_t goToFirstNode;
+    int64_t goToAllStarted;
+    int64_t stopToBestMove;
+};
+
+
+// How many threads had the move that was played as their best move, for the
+// last search. Only threads that completed at least one depth vote.
+struct SearchAgreement {
+    Move   bestMove;
+    size_t nbAgreeing;
+    size_t nbVoting;
+};
+
 
 class Thread {
 public:
     Thread(
         size_t index,
-        Search::SearchWorkerShared& sharedState
-    ) :
-        idx(index),
-        thread(&Thread::idle, this)
-    {
-        worker = std::make_unique<Search::SearchWorker>(sharedState, index);
-    }
+        Search::SearchWorkerShared& sharedState,
+        bool bindThread
+    );
 
     virtual ~Thread();
 
-    void search();
-    void clear();
-    void idle();
-
-    void waitForFinish();
-    bool isSearching() { return searching; }
-
     size_t id() const { return idx; }
 
     std::unique_ptr<Search::SearchWorker> worker;
 
-    void setupWorker(
-        const Position& rootPosition,
-        Search::RootMoveList rootMoves,
-        const Search::SearchLimits limits
-    ) {
-        worker->rootPosition = rootPosition;
-        worker->rootMoves    = rootMoves;
-        worker->limits       = limits;
-    }
-
 private:
-    size_t idx;
+    friend class ThreadPool;
+
+    void run(Search::SearchWorkerShared& sharedState, bool bindThread);
+    void idle();
 
-    std::mutex              mutex;
-    std::condition_variable cv;
-    std::thread             thread;
+    size_t      idx;
+    ThreadPool& pool;
 
-    bool shouldExit = false;
-    bool searching  = true;
+    std::atomic_bool shouldExit = false;
+
+    // Must be declared last: the thread starts as soon as it is constructed
+    std::thread thread;
 };
 
 
@@ -69,7 +85,7 @@ public:
 
     // Constructor / destructor
     ThreadPool() {}
-    ~ThreadPool() { clearThreads(); }
+    ~ThreadPool();
 
     // ThreadPool cannot be copied
     ThreadPool(const ThreadPool &)            = delete;
@@ -79,16 +95,23 @@ public:
 
     // UCI commands
     void clearThreads();
-    void setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState);
+    void setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState, bool bindThreads = false);
 
     // Start / stop searching
     void go(
         Position& pos,
         Search::SearchLimits limits
     );
-    void startSearching();
+    void stop();
+    void ponderhit();
+
+    // Blocking waits
+    void waitForStop();
+    void waitForHelpers();
     void waitForFinish();
 
+    inline bool isSearching() const { return nbRunning.load(std::memory_order_acquire) != 0; }
+
     // Find specific threads / workers
     Thread* bestThread() const;
     Thread* firstThread() const { return threads.front().get(); }
@@ -105,13 +128,68 @@ public:
     // Get info from threads
     uint64_t totalNodesSearched() const;
     uint64_t totalTbHits() const;
+    TTStats  totalTTStats() const;
+    TTStats  totalQTTStats() const;
+    Eval::EvalCacheStats totalEvalCacheStats() const;
+    Search::CutoffStats totalCutoffStats() const;
+    Search::SearchStats totalSearchStats() const;
+
+    // Latency and agreement measurement
+    void onSearchStarted();
+    void onBestMove(Move bestMove);
+    SearchLatency   getLatency() const;
+    SearchAgreement getAgreement() const { return agreement; }
 
     // Stop variable
     std::atomic_bool shouldStop;
     std::atomic_bool abortSearch;
 
+    // Pondering: the search runs without limits until ponderhit. If it would
+    // have stopped in the meantime, stopOnPonderhit is set instead.
+    std::atomic_bool ponder;
+    std::atomic_bool stopOnPonderhit;
+
+    // Root of the current search. Set up once per go, each worker then copies
+    // it into its own position when it starts, in parallel with the others.
+    PositionSnapshot     rootSnapshot;
+    Search::RootMoveList rootMoves;
+    Search::SearchLimits searchLimits;
+    TimeManager          timeManager;
+
+    // Whether the current threads were pinned when they were created
+    bool threadsBound = false;
+
+    // Parallel search strategy, only changed while the pool is idle
+    ParallelMode   parallelMode = ParallelMode::LAZY_SMP;
+    SearchingTable searching;
+
+    // Number of root moves to search and report a line for (UCI MultiPV)
+    size_t multiPV = 1;
+
+    // Report the nodes spent on each root move along with the PV
+    bool reportRootMoveNodes = false;
+
 private:
+    friend class Thread;
+
+    void startTask(ThreadTask task);
+    void onTaskFinished();
+    void removeThreads(size_t nbThreads);
+
     ThreadList threads;
+
+    // Start barrier. Idle threads sleep (on a futex) until the epoch changes,
+    // so a single store releases every thread together. The low bits of the
+    // epoch hold the task to run, so that a thread never sees an epoch and a
+    // task that do not belong together.
+    std::atomic<uint64_t> epoch     = 0;
+    std::atomic<size_t>   nbRunning = 0;
+
+    // Timestamps of the last search, in microseconds
+    std::atomic<int64_t> goTime = 0, firstNodeTime = 0, allStartedTime = 0, stopTime = 0, bestMoveTime = 0;
+    std::atomic<size_t>  nbStarted = 0;
+
+    SearchAgreement agreement = {MOVE_NONE, 0, 0};
 };
 
 } // namespace Atom
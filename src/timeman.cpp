@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include "timeman.h"
+#include "search.h"
+#include "tunables.h"
+#include "types.h"
+
+namespace Atom {
+
+void TimeManager::init(const Search::SearchLimits& limits, Color us) {
+    startTime.store(limits.startTimePoint, std::memory_order_relaxed);
+
+    const TimePoint time = limits.time[us];
+    const TimePoint inc  = limits.inc[us];
+
+    useTime      = !limits.isInfinite && (limits.moveTime > 0 || time > 0);
+    canStopEarly = limits.moveTime == 0;
+
+    if (!useTime) {
+        optimumTime = maximumTime = 0;
+        return;
+    }
+
+    // Fixed time per move
+    if (limits.moveTime > 0) {
+        optimumTime = maximumTime = std::max<TimePoint>(1, limits.moveTime - Tunables::TM_MOVE_OVERHEAD);
+        return;
+    }
+
+    // Spread the clock, plus the increments still to come, over the moves
+    // left until the next time control, or over a fixed horizon in sudden death.
+    // Every move also loses some overhead to communication lag.
+    const int movesToGo = limits.movesToGo > 0 ? std::min(limits.movesToGo, Tunables::TM_MOVE_HORIZON)
+                                               : Tunables::TM_MOVE_HORIZON;
+
+    const TimePoint timeLeft = std::max<TimePoint>(1,
+        time + inc * (movesToGo - 1) - Tunables::TM_MOVE_OVERHEAD * (2 + movesToGo));
+
+    optimumTime = timeLeft / movesToGo;
+
+    // Never use more than a fixed share of what is actually on the clock
+    maximumTime = std::min<TimePoint>(
+        optimumTime * Tunables::TM_MAX_SCALE,
+        time * Tunables::TM_MAX_CLOCK_PERCENT / 100 - Tunables::TM_MOVE_OVERHEAD
+    );
+
+    maximumTime = std::max<TimePoint>(1, maximumTime);
+    optimumTime = std::clamp<TimePoint>(optimumTime, 1, maximumTime);
+}
+
+
+bool TimeManager::shouldStopIterating(double bestMoveChanges, Value scoreDrop, int bestMoveEffort) const {
+    if (!useTime || !canStopEarly) {
+        return false;
+    }
+
+    // An unstable best move needs more time to settle
+    const double instability = 1.0 + Tunables::TM_INSTABILITY_SCALE * bestMoveChanges / 100;
+
+    // A falling score means that we may be walking into trouble: think longer.
+    // A rising one means that the move is fine, and we can move sooner.
+    const double fallingEval = std::clamp(
+        (Tunables::TM_FALLING_EVAL_BASE + Tunables::TM_FALLING_EVAL_SCALE * scoreDrop) / 100.0,
+        Tunables::TM_FALLING_EVAL_MIN / 100.0,
+        Tunables::TM_FALLING_EVAL_MAX / 100.0
+    );
+
+    // If nearly all the nodes went into the best move, the alternatives were
+    // refuted quickly, and the move is unlikely to change
+    const double effort = bestMoveEffort >= Tunables::TM_EFFORT_THRESHOLD ? Tunables::TM_EFFORT_SCALE / 100.0 : 1.0;
+
+    const double totalTime = optimumTime * instability * fallingEval * effort;
+
+    // The next iteration will take longer than all the previous ones together,
+    // so do not start one that is unlikely to finish in time
+    return elapsed() > std::min<double>(totalTime, maximumTime) * Tunables::TM_NEXT_ITERATION_PERCENT / 100;
+}
+
+} // namespace Atom
@@ -0,0 +1,52 @@
+#ifndef TIMEMAN_H
+#define TIMEMAN_H
+
+#include <atomic>
+
+#include "search.h"
+#include "types.h"
+
+namespace Atom {
+
+// Decides how long the search of a move may take, from the clock given by go.
+//
+// - optimum: the time the search should normally take. The main thread
+//   compares it, scaled by how unsettled the search still is, against the
+//   elapsed time after each iteration (see shouldStopIterating).
+// - maximum: hard limit, checked from inside the search. The search is
+//   stopped as soon as it is reached, even in the middle of an iteration.
+//
+// With movetime, both are the given time and the search is never stopped
+// early. Without any time limit (infinite, depth, nodes...) the time manager
+// is disabled.
+//
+// When pondering, the clock only starts once the opponent has played the
+// expected move: ponderhit restarts the elapsed time from there.
+class TimeManager {
+public:
+    void init(const Search::SearchLimits& limits, Color us);
+
+    inline bool      enabled()  const { return useTime; }
+    inline TimePoint optimum()  const { return optimumTime; }
+    inline TimePoint maximum()  const { return maximumTime; }
+    inline TimePoint elapsed()  const { return now() - startTime.load(std::memory_order_relaxed); }
+
+    inline void onPonderhit() { startTime.store(now(), std::memory_order_relaxed); }
+
+    // Called by the main thread after every completed iteration.
+    // - bestMoveChanges: recent best move changes, decayed every iteration
+    // - scoreDrop: how much the score fell since the previous iterations
+    // - bestMoveEffort: share of the iteration's nodes spent on the best move, in %
+    bool shouldStopIterating(double bestMoveChanges, Value scoreDrop, int bestMoveEffort) const;
+
+private:
+    std::atomic<TimePoint> startTime = 0;
+    TimePoint optimumTime = 0;
+    TimePoint maximumTime = 0;
+    bool      useTime     = false;
+    bool      canStopEarly = false;
+};
+
+} // namespace Atom
+
+#endif // TIMEMAN_H
@@ -0,0 +1,79 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "trace.h"
+
+namespace Atom {
+
+namespace Trace {
+
+#if defined(SEARCH_TRACE)
+
+// Opens the trace file of the thread and starts its writer.
+// Called by the worker before it starts searching.
+void Tracer::start(size_t threadIdx) {
+    finish();
+
+    const std::string path = "trace_" + std::to_string(threadIdx) + ".bin";
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::fprintf(stderr, "Error: could not open trace file %s\n", path.c_str());
+    }
+
+    writePos = readPos = 0;
+    done     = false;
+    writer   = std::thread(&Tracer::writeLoop, this);
+}
+
+
+// Waits for every record to be written, and closes the file.
+// Called by the worker once it has stopped searching.
+void Tracer::finish() {
+    if (!writer.joinable()) return;
+
+    done = true;
+    writer.join();
+
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+
+// Writes the records as they come, in as few writes as possible: everything
+// pushed since the last write, in at most two parts when it wraps around the
+// end of the ring.
+void Tracer::writeLoop() {
+    uint64_t r = 0;
+
+    while (true) {
+        // Read the flag first: records pushed before it was set are then seen
+        const bool     last = done.load(std::memory_order_acquire);
+        const uint64_t w    = writePos.load(std::memory_order_acquire);
+
+        if (w == r) {
+            if (last) return;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        const uint64_t begin = r & (RING_SIZE - 1);
+        const uint64_t count = std::min(w - r, RING_SIZE - begin);
+
+        if (file) {
+            std::fwrite(&ring[begin], sizeof(Record), count, file);
+        }
+
+        r += count;
+        readPos.store(r, std::memory_order_release);
+    }
+}
+
+#endif
+
+} // namespace Trace
+
+} // namespace Atom
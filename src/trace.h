@@ -0,0 +1,179 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "types.h"
+
+namespace Atom {
+
+namespace Trace {
+
+// Search tree trace, for offline analysis of the search (see tools/tracereader.cpp).
+//
+// Only compiled in with SEARCH_TRACE=yes (see Makefile). Each worker then
+// writes one record per node it searched to trace_<thread index>.bin in the
+// working directory, overwriting the file at each go. Records are written
+// when the node returns, so the file holds the tree in post-order: the
+// subtreeSize - 1 records before a record are its descendants, which is
+// enough to rebuild any subtree.
+//
+// Without SEARCH_TRACE, Tracer and NodeTrace are empty classes whose calls
+// compile away.
+
+
+// Why a node returned
+enum Reason : uint8_t {
+    REASON_DRAW,            // Draw, or the search was stopped (pvSearch can not tell them apart)
+    REASON_ABORTED,         // The search was stopped
+    REASON_MATE_DISTANCE,
+    REASON_TT_CUTOFF,
+    REASON_RFP,
+    REASON_RAZORING,
+    REASON_FUTILITY,
+    REASON_NULL_MOVE,
+    REASON_PROBCUT,
+    REASON_QSEARCH,         // Depth dropped to zero, the qsearch result was returned
+    REASON_STAND_PAT,
+    REASON_NO_MOVES,        // Checkmate or stalemate
+    REASON_BETA_CUTOFF,
+    REASON_EXACT,           // Raised alpha without failing high
+    REASON_FAIL_LOW,
+    REASON_NB
+};
+
+enum NodeKind : uint8_t {
+    NODE_ROOT,
+    NODE_PV,
+    NODE_NON_PV,
+    NODE_QSEARCH_PV,
+    NODE_QSEARCH_NON_PV,
+    NODE_KIND_NB
+};
+
+
+// One node, as written to the trace file
+struct Record {
+    uint64_t hash;
+    uint32_t subtreeSize;  // Records in the subtree of the node, itself included
+    int16_t  alpha, beta;  // Window the node was called with
+    int16_t  eval;         // Static eval, VALUE_NONE if not computed
+    int16_t  score;
+    Move     move;         // Move that led to the node, MOVE_NONE at the root
+    Move     bestMove;
+    int16_t  depth;
+    uint8_t  ply;
+    NodeKind kind;
+    Reason   reason;
+    uint8_t  moveCount;
+};
+
+static_assert(sizeof(Record) == 32, "Trace records are read back as raw bytes");
+
+
+#if defined(SEARCH_TRACE)
+
+// Per worker buffer of records, flushed to the trace file by a writer thread.
+// The worker and the writer share a single producer / single consumer ring:
+// when the writer falls behind the worker waits for it, so that no record is
+// lost and subtree sizes stay valid.
+class Tracer {
+public:
+    ~Tracer() { finish(); }
+
+    void start(size_t threadIdx);
+    void finish();
+
+    inline uint64_t written() const { return writePos.load(std::memory_order_relaxed); }
+
+    inline void push(const Record& record) {
+        const uint64_t w = writePos.load(std::memory_order_relaxed);
+        while (w - readPos.load(std::memory_order_acquire) == RING_SIZE) {
+            std::this_thread::yield();
+        }
+
+        ring[w & (RING_SIZE - 1)] = record;
+        writePos.store(w + 1, std::memory_order_release);
+    }
+
+private:
+    static constexpr uint64_t RING_SIZE = 1 << 16;
+
+    void writeLoop();
+
+    std::array<Record, RING_SIZE> ring;
+    alignas(64) std::atomic<uint64_t> writePos = 0;
+    alignas(64) std::atomic<uint64_t> readPos  = 0;
+    std::atomic<bool> done = false;
+
+    std::FILE*  file = nullptr;
+    std::thread writer;
+};
+
+
+// Records one node: set up on entry, and written by exit(), which wraps every
+// return of the search functions.
+class NodeTrace {
+public:
+    inline NodeTrace(Tracer& tracer, uint64_t hash, int ply, Depth depth, Value alpha, Value beta,
+                     NodeKind kind, Move move) :
+        tracer(tracer),
+        firstRecord(tracer.written())
+    {
+        record.hash  = hash;
+        record.move  = move;
+        record.ply   = uint8_t(ply);
+        record.depth = int16_t(depth);
+        record.alpha = int16_t(alpha);
+        record.beta  = int16_t(beta);
+        record.kind  = kind;
+        record.eval  = int16_t(VALUE_NONE);
+    }
+
+    inline void setEval(Value eval) { record.eval = int16_t(eval); }
+
+    inline Value exit(Value score, Reason reason, Move bestMove = MOVE_NONE, int moveCount = 0) {
+        record.score       = int16_t(score);
+        record.reason      = reason;
+        record.bestMove    = bestMove;
+        record.moveCount   = uint8_t(std::min(moveCount, 255));
+        record.subtreeSize = uint32_t(tracer.written() - firstRecord + 1);
+        tracer.push(record);
+        return score;
+    }
+
+private:
+    Tracer&  tracer;
+    uint64_t firstRecord;
+    Record   record = {};  // Also zeroes the padding, which is written too
+};
+
+#else
+
+class Tracer {
+public:
+    inline void start(size_t) {}
+    inline void finish() {}
+};
+
+class NodeTrace {
+public:
+    inline NodeTrace(Tracer&, uint64_t, int, Depth, Value, Value, NodeKind, Move) {}
+
+    inline void  setEval(Value) {}
+    inline Value exit(Value score, Reason, Move = MOVE_NONE, int = 0) { return score; }
+};
+
+#endif
+
+} // namespace Trace
+
+} // namespace Atom
+
+#endif // TRACE_H
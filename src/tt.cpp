@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include "tt.h"
 #include "memory.h"
@@ -29,11 +32,11 @@ void TTEntry::save(
         (depth - DEPTH_DELTA + 2*isPv > depth8 - 4) ||
         relativeAge(age)
     ) {
-        key16   = uint16_t(key);
-        depth8  = uint8_t(depth - DEPTH_DELTA);
-        age8    = uint8_t(age | (uint8_t(isPv) << 2) | bound);
-        score16 = int16_t(score);
-        eval16  = int16_t(eval);
+        keyStore = TTKeyStore(key);
+        depth8   = uint8_t(depth - DEPTH_DELTA);
+        age8     = uint8_t(age | (uint8_t(isPv) << 2) | bound);
+        score16  = int16_t(score);
+        eval16   = int16_t(eval);
     }
 }
 
@@ -51,10 +54,10 @@ void TTWriter::write(
 
 std::tuple<bool, TTData, TTWriter> TranspositionTable::probe(const TTKey key) const {
     TTEntry* const entry = lookup(key);
-    const uint16_t key16 = uint16_t(key);
+    const TTKeyStore keyStore = TTKeyStore(key);
 
     for (int i = 0; i < ENTRIES_PER_CLUSTER; ++i) {
-        if (entry[i].key16 == key16) {
+        if (entry[i].keyStore == keyStore) {
             return {entry[i].isOccupied(), entry[i].read(), TTWriter(&entry[i])};
         }
     }
@@ -72,6 +75,8 @@ std::tuple<bool, TTData, TTWriter> TranspositionTable::probe(const TTKey key) co
 
 // Only reads the first 1000 samples.
 int TranspositionTable::hashfull() const {
+    if (empty()) return 0;
+
     int count = 0;
     for (int i = 0; i < 1000; ++i) {
         for (int j = 0 ; j < ENTRIES_PER_CLUSTER; ++j) {
@@ -85,22 +90,119 @@ int TranspositionTable::hashfull() const {
 
 void TranspositionTable::clear() {
     age = 0;
-    std::memset(table, 0, nbClusters * sizeof(TTCluster));
+    if (!empty()) std::memset(table, 0, nbClusters * sizeof(TTCluster));
 }
 
 
-void TranspositionTable::resize(size_t newSize) {
-    aligned_large_pages_free(table);
+// Resizes the table. A size of zero leaves the table empty: it must not be probed.
+//
+// With keepEntries, the live entries of the old table are rehashed into the
+// new one instead of being discarded (see rehash()).
+void TranspositionTable::resize(size_t newSize, size_t nbThreads, bool keepEntries) {
+    TTCluster*   oldTable    = table;
+    const size_t oldClusters = nbClusters;
+
+    table      = nullptr;
+    nbClusters = 0;
+
+    if (newSize != 0) {
+        nbClusters = (newSize * 1024 * 1024) / sizeof(TTCluster);
+        table = static_cast<TTCluster*>(aligned_large_pages_alloc(nbClusters * sizeof(TTCluster)));
 
-    nbClusters = (newSize * 1024 * 1024) / sizeof(TTCluster);
-    table = static_cast<TTCluster*>(aligned_large_pages_alloc(nbClusters * sizeof(TTCluster)));
+        if (!table) {
+            std::cerr << "Failed to allocate transposition table with " << newSize << "MB." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
 
-    if (!table) {
-        std::cerr << "Failed to allocate transposition table with " << newSize << "MB." << std::endl;
-        exit(EXIT_FAILURE);
+    if (keepEntries && oldClusters && !empty()) {
+        std::memset(table, 0, nbClusters * sizeof(TTCluster));
+        rehash(oldTable, oldClusters, nbThreads);
+    } else {
+        clear();
     }
 
-    clear();
+    aligned_large_pages_free(oldTable);
+}
+
+
+// Smallest key that maps to the given cluster: the inverse of clusterIndex().
+static inline unsigned __int128 firstKeyOf(size_t idx, size_t nbClusters) {
+    return (((unsigned __int128)idx << 64) + nbClusters - 1) / nbClusters;
+}
+
+
+// Moves the entries of the old table into the new one.
+//
+// Each thread fills its own range of new clusters, so no two threads ever
+// write to the same cluster. Since clusterIndex() is monotonic, the old
+// clusters feeding a range of new clusters are also a contiguous range.
+void TranspositionTable::rehash(const TTCluster* oldTable, size_t oldClusters, size_t nbThreads) {
+    nbThreads = std::max<size_t>(nbThreads, 1);
+
+    std::vector<std::thread> workers;
+    const size_t chunk = (nbClusters + nbThreads - 1) / nbThreads;
+
+    for (size_t first = 0; first < nbClusters; first += chunk) {
+        const size_t last = std::min(nbClusters, first + chunk);
+        workers.emplace_back([=, this]() { rehashRange(oldTable, oldClusters, first, last); });
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+
+// Rehashes the old entries that belong in new clusters [first, last).
+//
+// With the wide layout the full key is stored, so the new cluster is exact.
+// Otherwise the key is only known to lie in the range of keys owned by its
+// old cluster. When the table shrinks this range almost always maps to a
+// single new cluster; when it grows, the entry is copied into every new
+// cluster the range maps to. The copies in the wrong clusters only match
+// positions with the same key bits, like any other stale entry, and are
+// replaced as the search goes on.
+//
+// When a new cluster is full, the least valuable entry is replaced according
+// to isBetterThan, and entries that are worse than all of them are dropped.
+void TranspositionTable::rehashRange(const TTCluster* oldTable, size_t oldClusters, size_t first, size_t last) {
+    const size_t oldFirst = clusterIndex(TTKey(firstKeyOf(first, nbClusters)), oldClusters);
+    const size_t oldLast  = clusterIndex(TTKey(firstKeyOf(last, nbClusters) - 1), oldClusters);
+
+    for (size_t i = oldFirst; i <= oldLast; ++i) {
+        const size_t lo = clusterIndex(TTKey(firstKeyOf(i, oldClusters)), nbClusters);
+        const size_t hi = clusterIndex(TTKey(firstKeyOf(i + 1, oldClusters) - 1), nbClusters);
+
+        for (const TTEntry& entry : oldTable[i].entries) {
+            if (!entry.isOccupied()) continue;
+
+            size_t begin = std::max(lo, first), end = std::min(hi + 1, last);
+            if constexpr (sizeof(TTKeyStore) == sizeof(TTKey)) {
+                begin = clusterIndex(entry.keyStore, nbClusters);
+                end   = begin < first || begin >= last ? begin : begin + 1;
+            }
+
+            for (size_t idx = begin; idx < end; ++idx) {
+                // Find an empty slot, or the least valuable entry to replace
+                TTEntry* replace = &table[idx].entries[0];
+                for (TTEntry& candidate : table[idx].entries) {
+                    if (!candidate.isOccupied()) {
+                        replace = &candidate;
+                        break;
+                    }
+
+                    if (replace->isBetterThan(candidate, age)) {
+                        replace = &candidate;
+                    }
+                }
+
+                if (!replace->isOccupied() || entry.isBetterThan(*replace, age)) {
+                    *replace = entry;
+                }
+            }
+        }
+    }
 }
 
 } // namespace Atom
@@ -12,10 +12,30 @@ namespace Atom {
 
 using TTKey = uint64_t;
 
-constexpr size_t TT_DEFAULT_SIZE = 16;
-
-constexpr uint8_t ENTRIES_PER_CLUSTER = 3;
-constexpr uint8_t DEPTH_DELTA = -3;
+constexpr size_t TT_DEFAULT_SIZE  = 16;
+constexpr size_t QTT_DEFAULT_SIZE = 0;   // Quiescence search table is disabled by default
+
+// Cluster layout, selected at compile time (see Makefile TT_LAYOUT).
+// Every layout keeps the same TTEntry / TTWriter / probe API, only the
+// number of entries per cluster and the number of stored key bits change.
+#if defined(TT_LAYOUT_CACHELINE)
+using TTKeyStore = uint32_t;                    // 32 bit key verification
+constexpr uint8_t ENTRIES_PER_CLUSTER = 4;      // (12 * 4) bytes
+constexpr size_t  CLUSTER_SIZE        = 64;     // One cache line
+constexpr char    TT_LAYOUT_NAME[]    = "cacheline (4 x 32 bit keys, 64 bytes)";
+#elif defined(TT_LAYOUT_WIDE)
+using TTKeyStore = uint64_t;                    // Full key verification
+constexpr uint8_t ENTRIES_PER_CLUSTER = 2;      // (16 * 2) bytes
+constexpr size_t  CLUSTER_SIZE        = 32;
+constexpr char    TT_LAYOUT_NAME[]    = "wide (2 x 64 bit keys, 32 bytes)";
+#else
+using TTKeyStore = uint16_t;                    // 16 bit key verification
+constexpr uint8_t ENTRIES_PER_CLUSTER = 3;      // (10 * 3) bytes
+constexpr size_t  CLUSTER_SIZE        = 32;
+constexpr char    TT_LAYOUT_NAME[]    = "default (3 x 16 bit keys, 32 bytes)";
+#endif
+
+constexpr int     DEPTH_DELTA = -3;
 constexpr uint8_t BOUND_MASK  = 0b00000011;
 constexpr uint8_t PV_MASK     = 0b00000100;
 constexpr uint8_t AGE_MASK    = 0b11111000;
@@ -23,6 +43,13 @@ constexpr int     AGE_DELTA   = 0x8;
 constexpr int     AGE_CYCLE   = 0xFF + AGE_DELTA;
 
 
+// Index of the cluster a key maps to in a table of nbClusters clusters.
+// Monotonic in the key, so each cluster owns a contiguous range of keys.
+inline size_t clusterIndex(TTKey key, size_t nbClusters) {
+    return ((unsigned __int128)key * (unsigned __int128)nbClusters) >> 64;
+}
+
+
 inline Value valueToTT(Value v, int ply) {
     return v >= VALUE_TB_WIN_IN_MAX_PLY ? v + ply : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v - ply : v;
 }
@@ -52,8 +79,8 @@ struct TTEntry {
             .score = Value(score16),
             .eval  = Value(eval16),
             .depth = Depth(depth8 + DEPTH_DELTA),
-            .bound = Bound(depth8 & 0x3),
-            .isPv  = bool (depth8 & BOUND_MASK),
+            .bound = Bound(age8 & BOUND_MASK),
+            .isPv  = bool (age8 & PV_MASK),
         };
     }
 
@@ -69,7 +96,7 @@ struct TTEntry {
         uint8_t age, Bound bound
     );
 
-    inline bool hashEquals(TTKey key) const { return uint16_t(key) == key16; }
+    inline bool hashEquals(TTKey key) const { return TTKeyStore(key) == keyStore; }
 
     inline uint8_t age() const { return age8 & AGE_MASK; }
 
@@ -84,7 +111,7 @@ struct TTEntry {
       friend class TranspositionTable;
 
       // Keep these in this order
-      uint16_t key16;
+      TTKeyStore keyStore;
       uint8_t depth8;
       uint8_t age8;
       Move move16;
@@ -108,14 +135,32 @@ private:
 };
 
 
-class TTCluster {
+class alignas(CLUSTER_SIZE) TTCluster {
     inline TTEntry *begin() { return &entries[0]; }
     inline TTEntry *end()   { return &entries[ENTRIES_PER_CLUSTER]; }
 
     friend class TranspositionTable;
-    TTEntry  entries[ENTRIES_PER_CLUSTER]; // (10 * 3) bytes
-    uint16_t padding;               // 2 bytes
-};  // Must be exactly 32 bytes
+    TTEntry  entries[ENTRIES_PER_CLUSTER]; // Padded up to CLUSTER_SIZE by alignment
+};
+
+static_assert(sizeof(TTCluster) == CLUSTER_SIZE, "TTCluster must fill exactly CLUSTER_SIZE bytes");
+
+
+// Probe statistics, collected by each search worker for benchmarking.
+// A collision is a hit whose stored move is not pseudo-legal in the
+// probing position: the stored key bits matched a different position.
+struct TTStats {
+    uint64_t probes     = 0;
+    uint64_t hits       = 0;
+    uint64_t collisions = 0;
+
+    inline TTStats& operator+=(const TTStats& other) {
+        probes     += other.probes;
+        hits       += other.hits;
+        collisions += other.collisions;
+        return *this;
+    }
+};
 
 
 class TranspositionTable {
@@ -127,7 +172,7 @@ public:
     ~TranspositionTable() { aligned_large_pages_free(table); }
 
     inline TTEntry* lookup(const TTKey key) const {
-        return &table[((unsigned __int128)key * (unsigned __int128)nbClusters) >> 64].entries[0];
+        return &table[clusterIndex(key, nbClusters)].entries[0];
     }
 
     inline void prefetch(TTKey key) const { __builtin_prefetch(lookup(key)); }
@@ -137,14 +182,18 @@ public:
     // UCI commands
     int    hashfull() const;
     void   clear();
-    void   resize(size_t newSize);
+    void   resize(size_t newSize, size_t nbThreads = 1, bool keepEntries = false);
 
     inline void onNewSearch() { age += AGE_DELTA; }
 
     inline size_t  size()   const { return nbClusters; }
+    inline bool    empty()  const { return nbClusters == 0; }
     inline uint8_t getAge() const { return age; }
 
 private:
+    void rehash(const TTCluster* oldTable, size_t oldClusters, size_t nbThreads);
+    void rehashRange(const TTCluster* oldTable, size_t oldClusters, size_t first, size_t last);
+
     TTCluster* table;
     size_t     nbClusters;
     uint8_t    age;
@@ -11,8 +11,39 @@ constexpr int ASPIRATION_WINDOW_DIVISOR = 120;
 
 constexpr int DELTA_INCREMENT_DIV = 3;
 
+// Lazy SMP: helper threads skip some iterations of the iterative deepening so
+// that they spread over several depths instead of all searching the same one.
+// Helper i uses pattern (i - 1) % SMP_SKIP_PATTERNS, and skips a depth when
+// (depth + phase) / size is odd.
+constexpr int SMP_SKIP_PATTERNS = 20;
+constexpr int SMP_SKIP_SIZE[SMP_SKIP_PATTERNS]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SMP_SKIP_PHASE[SMP_SKIP_PATTERNS] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// Helpers open their aspiration windows wider by this much per step of idx % 4
+constexpr int SMP_ASPIRATION_STEP = 4;
+
+// ABDADA: moves being searched by another thread are only deferred from this depth on
+constexpr int ABDADA_DEFER_DEPTH = 3;
+
+// A thread votes for its best move with (score - lowest score + offset) * completed depth
+constexpr int SMP_VOTE_SCORE_OFFSET = 14;
+
 constexpr int UPDATE_NODES = 1000000;
 
+// Time management, see TimeManager. Scales and factors are in percent.
+constexpr int TM_MOVE_OVERHEAD          = 10;   // ms lost per move to communication lag
+constexpr int TM_MOVE_HORIZON           = 40;   // Moves to spread the clock over in sudden death
+constexpr int TM_MAX_SCALE              = 5;    // Hard limit, as a multiple of the optimum time
+constexpr int TM_MAX_CLOCK_PERCENT      = 80;   // Never use more of the remaining clock than this
+constexpr int TM_INSTABILITY_SCALE      = 150;  // Extra time per (decayed) best move change
+constexpr int TM_FALLING_EVAL_BASE      = 100;
+constexpr int TM_FALLING_EVAL_SCALE     = 1;    // Extra time per centipawn the score dropped
+constexpr int TM_FALLING_EVAL_MIN       = 60;
+constexpr int TM_FALLING_EVAL_MAX       = 150;
+constexpr int TM_EFFORT_THRESHOLD       = 90;   // Share of the nodes spent on the best move...
+constexpr int TM_EFFORT_SCALE           = 70;   // ...above which the time is scaled by this
+constexpr int TM_NEXT_ITERATION_PERCENT = 60;   // Share of the time after which no new iteration is started
+
 constexpr int IIR_REDUCTION = 3;
 
 constexpr int RFP_DEPTH = 4;
@@ -37,6 +68,12 @@ constexpr int NMP_VERIFICATION_MIN_DEPTH = 16;
 constexpr int NMP_DEPTH_SCALE = 3;
 constexpr int NMP_DEPTH_DIVISOR = 4;
 
+// ProbCut: a capture that beats beta + margin at depth - reduction is taken as a cutoff
+constexpr int PROBCUT_MIN_DEPTH = 5;
+constexpr int PROBCUT_MARGIN = 200;
+constexpr int PROBCUT_IMPROVING_MARGIN = 60;
+constexpr int PROBCUT_DEPTH_REDUCTION = 4;
+
 constexpr int MOVEPICK_CAPTURE_MULTIPLIER = 7;
 constexpr int MOVEPICK_KILLER_SCORE = 1 << 16;
 constexpr int MOVEPICK_CHECK_SCORE  = 16384;
@@ -49,10 +86,20 @@ constexpr int MOVEPICKER_ENPRISE_QUEEN = 49000;
 constexpr int MOVEPICKER_ENPRISE_ROOK  = 24335;
 constexpr int MOVEPICKER_ENPRISE_MINOR = 14900;
 
+constexpr int MOVEPICK_MAIN_HISTORY_WEIGHT = 2;
+constexpr int MOVEPICK_CAPTURE_HISTORY_DIV = 64;
+
 constexpr int MOVEPICKER_LOSING_CAP_THRESHOLD = 18;
 constexpr int MOVEPICKER_QUIET_THRESHOLD = -3560;
 constexpr int MOVEPICKER_GOOD_QUIET_THRESHOLD = -7998;
 
+constexpr int HISTORY_MAX          = 16384;
+constexpr int HISTORY_BONUS_MULT   = 300;
+constexpr int HISTORY_BONUS_OFFSET = 250;
+constexpr int HISTORY_BONUS_MAX    = 1600;
+
+constexpr int STAT_SCORE_OFFSET = 4000;
+
 constexpr int CUTNODE_MIN_DEPTH = 7;
 
 constexpr int SEE_PRUNING_MAX_DEPTH = 10;
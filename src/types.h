@@ -342,10 +342,20 @@ public:
         copy(il.begin(), il.end(), begin());
         size_ = il.end() - il.begin();
     }
-    inline ValueList(ValueList const &vl)            = default;
-    inline ValueList(ValueList&&)                    = default;
-    inline ValueList& operator=(ValueList const &ml) = default;
-    inline ValueList& operator=(ValueList&&)         = default;
+
+    // Copies only the elements in use, not the whole capacity
+    inline ValueList(ValueList const &vl) : size_(vl.size_) {
+        std::copy(vl.begin(), vl.end(), begin());
+    }
+    inline ValueList& operator=(ValueList const &vl) {
+        if (this != &vl) {
+            size_ = vl.size_;
+            std::copy(vl.begin(), vl.end(), begin());
+        }
+        return *this;
+    }
+    inline ValueList(ValueList&& vl) noexcept : ValueList(vl) {}
+    inline ValueList& operator=(ValueList&& vl) noexcept { return *this = vl; }
 
     // Get data from list itself
     const Tn* begin() const { return &data_[0]; };
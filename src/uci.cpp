@@ -1,12 +1,16 @@
 
 #include <algorithm>
+#include <charconv>
 #include <cmath>
 #include <cstdlib>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <type_traits>
 
 #include "uci.h"
+#include "alloccount.h"
+#include "bench.h"
 #include "movegen.h"
 #include "nnue.h"
 #include "position.h"
@@ -150,40 +154,108 @@ std::string Uci::formatScore(const Value& score, const Position& pos) {
 // UCI callbacks
 //
 
+namespace {
+
+// One line of output, built in a fixed buffer. The callbacks run on the
+// search threads: this lets them print without allocating, and sends each
+// line with a single write so that it can not be split by another thread.
+class OutputLine {
+public:
+    OutputLine& operator<<(std::string_view str) {
+        const size_t n = std::min(str.size(), CAPACITY - size);
+        std::copy_n(str.data(), n, buffer + size);
+        size += n;
+        return *this;
+    }
+
+    template<typename T> requires std::is_integral_v<T>
+    OutputLine& operator<<(T value) {
+        size = std::to_chars(buffer + size, buffer + CAPACITY, value).ptr - buffer;
+        return *this;
+    }
+
+    OutputLine& operator<<(Move m) { return *this << Uci::formatMove(m); }
+
+    void send() {
+        buffer[size++] = '\n';
+        std::cout.write(buffer, size).flush();
+    }
+
+private:
+    static constexpr size_t CAPACITY = 2047;  // Room for a MAX_PLY long pv
+
+    char   buffer[CAPACITY + 1];  // One more for the newline
+    size_t size = 0;
+};
+
+} // namespace
+
+
 void Uci::callbackBestMove(const std::string_view bestmove, const std::string_view ponder) {
-    std::cout << "bestmove " << bestmove;
-    if (!ponder.empty()) std::cout << " ponder " << ponder;
-    std::cout << std::endl;
+    OutputLine line;
+
+    line << "bestmove " << bestmove;
+    if (!ponder.empty()) line << " ponder " << ponder;
+
+    line.send();
 }
 
 
 void Uci::callbackInfo(const Search::SearchInfo info) {
-    std::stringstream ss;
-
-    ss << "info";
-    ss << " depth "    << info.depth
-       << " seldepth " << info.selDepth
-       << " score "    << info.score
-       << " nodes "    << info.nodesSearched
-       << " nps "      << (info.nodesSearched * 1000) / info.timeSearched
-       << " hashfull " << info.hashFull
-       << " tbhits "   << info.tbHits
-       << " time "     << info.timeSearched
-       << " pv "       << info.pv;
+    OutputLine line;
+
+    line << "info";
+    line << " depth "    << info.depth
+         << " seldepth " << info.selDepth
+         << " multipv "  << info.multiPV
+         << " score "    << info.score
+         << " nodes "    << info.nodesSearched
+         << " nps "      << (info.nodesSearched * 1000) / std::max<size_t>(info.timeSearched, 1)
+         << " hashfull " << info.hashFull
+         << " tbhits "   << info.tbHits
+         << " time "     << info.timeSearched
+         << " pv";
+
+    for (const Move m : info.pv) {
+        line << " " << m;
+    }
 
-    std::cout << ss.str() << std::endl;
+    line.send();
 }
 
 
 void Uci::callbackIter(const Depth depth, const Move currmove, const int currmovenumber) {
-    std::stringstream ss;
+    OutputLine line;
+
+    line << "info";
+    line << " depth "          << depth
+         << " currmove "       << currmove
+         << " currmovenumber " << currmovenumber;
+
+    line.send();
+}
 
-    ss << "info";
-    ss << " depth "          << depth
-       << " currmove "       << Uci::formatMove(currmove)
-       << " currmovenumber " << currmovenumber;
 
-    std::cout << ss.str() << std::endl;
+void Uci::callbackString(const std::string_view str) {
+    OutputLine line;
+    line << "info string " << str;
+    line.send();
+}
+
+
+// Not part of the UCI protocol: sent as an info string, when RootMoveNodes is set
+void Uci::callbackRootMoveNodes(const Depth depth, const Move move, const uint64_t nodes, const uint64_t rootNodes) {
+    const uint64_t effort = nodes * 10000 / std::max<uint64_t>(rootNodes, 1);  // In hundredths of a percent
+
+    OutputLine line;
+
+    line << "info string";
+    line << " depth "  << depth
+         << " move "   << move
+         << " nodes "  << nodes
+         << " effort " << effort / 100 << "." << effort / 10 % 10 << effort % 10 << "%";
+
+    line.send();
 }
 
 
@@ -215,11 +287,26 @@ void Uci::loop() {
             cmdGo(is);
         } else if (token == "stop") {
             cmdStop();
+        } else if (token == "ponderhit") {
+            cmdPonderhit();
         } else if (token == "perft") {
             cmdPerft(is);
+        } else if (token == "bench") {
+            cmdBench(is);
+        } else if (token == "latency") {
+            cmdLatency(is);
+        } else if (token == "nps") {
+            cmdNps(is);
+        } else if (token == "smp") {
+            cmdSmp(is);
+        } else if (token == "searchstats") {
+            cmdSearchStats();
+        } else if (token == "allocstats") {
+            cmdAllocStats();
         } else if (token == "debug" || token == "d") {
             cmdDebug();
         } else if (token == "quit") {
+            cmdQuit();
             break;
         } else if (token == "clear") {
             std::cout << "\033[2J\033[1;1H";
@@ -244,7 +331,14 @@ void Uci::loop() {
 // | setoption name <opt> value <val>  | * Sets the option <opt> to the value <val>   |
 // | go (wtime, btime etc)             | * Searches current position                  |
 // | stop                              |   Finish search threads and report bestmove  |
+// | ponderhit                         |   Expected move played, go on with the clock |
 // | perft <depth>                     |   Runs perft on current pos to given depth   |
+// | bench <depth> <hash sizes>        | * Runs bench positions once per hash size    |
+// | latency <iterations>              | * Measures go / stop latency of the threads  |
+// | nps <ms> <thread counts>          | * Measures NPS scaling with the thread count |
+// | smp <depth> <thread counts>       | * Measures time to depth and move agreement  |
+// | searchstats                       | * Search heuristic counters of the last go   |
+// | allocstats                        | * Heap allocations made by the last go       |
 // | debug (or just "d")               |   Prints the current position + debug info   |
 // | quit                              |   Ends the process                           |
 // | clear                             |   Clears the terminal                        |
@@ -257,10 +351,18 @@ void Uci::cmdUci() {
     std::cout << "id name Atom " << ENGINE_VERSION << std::endl;
     std::cout << "id author George Rawlinson and Tomáš Pecher" << std::endl;
     std::cout << std::endl;
-    std::cout << "option name Threads type spin default 1 min 1 max 16" << EvalFileDefaultNameBig << std::endl;
+    std::cout << "option name Threads type spin default " << NB_THREADS_DEFAULT << " min 1 max " << MAX_THREADS << std::endl;
     std::cout << "option name EvalFile type string default <inbuilt> " << EvalFileDefaultNameBig << std::endl;
     std::cout << "option name EvalFileSmall type string default <inbuilt> " << EvalFileDefaultNameSmall << std::endl;
     std::cout << "option name Hash type spin default 16 min 1 max 4096" << std::endl;
+    std::cout << "option name QSearchHash type spin default 0 min 0 max 1024" << std::endl;
+    std::cout << "option name MateHash type spin default " << Mate::MATE_HASH_DEFAULT_SIZE << " min 1 max 4096" << std::endl;
+    std::cout << "option name KeepHashOnResize type check default false" << std::endl;
+    std::cout << "option name BindThreads type check default false" << std::endl;
+    std::cout << "option name ParallelMode type combo default LazySMP var LazySMP var ABDADA" << std::endl;
+    std::cout << "option name Ponder type check default false" << std::endl;
+    std::cout << "option name MultiPV type spin default 1 min 1 max " << MAX_MOVE << std::endl;
+    std::cout << "option name RootMoveNodes type check default false" << std::endl;
     std::cout << "option name Clear Hash type button" << std::endl;
     std::cout << "uciok" << std::endl;
 }
@@ -309,15 +411,23 @@ void Uci::cmdPosition(std::istringstream& is) {
 
 
 void Uci::cmdSetOption(std::istringstream& is) {
-    // +---------------+---------------------------------------+---------------+
-    // |  Option       |                Value                  |    Default    |
-    // +---------------+---------------------------------------+---------------+
-    // | EvalFile      | (string)  Path to the big NNUE file   | <inbuilt>     |
-    // | EvalFileSmall | (string)  Path to the small NNUE file | <inbuilt>     |
-    // | Hash          | (spin)    Hash size, in MB            | 16            |
-    // | ClearHash     | (button)  Clears the hash             |               |
-    // | Threads       | (spin)    Number of threads to use    | 1             |
-    // +---------------+---------------------------------------+---------------+
+    // +------------------+---------------------------------------+---------------+
+    // |  Option          |                Value                  |    Default    |
+    // +------------------+---------------------------------------+---------------+
+    // | EvalFile         | (string)  Path to the big NNUE file   | <inbuilt>     |
+    // | EvalFileSmall    | (string)  Path to the small NNUE file | <inbuilt>     |
+    // | Hash             | (spin)    Hash size, in MB            | 16            |
+    // | QSearchHash      | (spin)    QSearch hash size, in MB    | 0 (disabled)  |
+    // | MateHash         | (spin)    go mate hash size, in MB    | 16            |
+    // | KeepHashOnResize | (check)   Keep entries when resizing  | false         |
+    // | ClearHash        | (button)  Clears the hash             |               |
+    // | Threads          | (spin)    Number of threads to use    | 1             |
+    // | BindThreads      | (check)   Pin threads to NUMA nodes   | false         |
+    // | ParallelMode     | (combo)   LazySMP or ABDADA           | LazySMP       |
+    // | Ponder           | (check)   GUI may send go ponder      | false         |
+    // | MultiPV          | (spin)    Number of lines to report   | 1             |
+    // | RootMoveNodes    | (check)   Report nodes per root move  | false         |
+    // +------------------+---------------------------------------+---------------+
 
     // INFO: The logic here may need to be reworked should we decide to add any options
     // that contain spaces in the name.
@@ -343,8 +453,24 @@ void Uci::cmdSetOption(std::istringstream& is) {
             engine.loadSmallNetFromFile(token);
         } else if (optName == "Hash") {
             engine.setHashSize(std::stoi(token));
+        } else if (optName == "QSearchHash") {
+            engine.setQSearchHashSize(std::stoi(token));
+        } else if (optName == "MateHash") {
+            engine.setMateHashSize(std::stoi(token));
+        } else if (optName == "KeepHashOnResize") {
+            engine.setKeepHashOnResize(toLower(token) == "true");
         } else if (optName == "Threads") {
             engine.setNbThreads(std::stoi(token));
+        } else if (optName == "BindThreads") {
+            engine.setBindThreads(toLower(token) == "true");
+        } else if (optName == "ParallelMode") {
+            engine.setParallelMode(toLower(token) == "abdada" ? ParallelMode::ABDADA : ParallelMode::LAZY_SMP);
+        } else if (optName == "MultiPV") {
+            engine.setMultiPV(std::stoi(token));
+        } else if (optName == "RootMoveNodes") {
+            engine.setReportRootMoveNodes(toLower(token) == "true");
+        } else if (optName == "Ponder") {
+            // Nothing to set up, pondering is driven by go ponder / ponderhit
         } else {
             std::cout << "Error: Unknown option name." << std::endl;
         }
@@ -385,6 +511,8 @@ Search::SearchLimits Uci::parseGoLimits(std::istringstream& is) {
             is >> limits.moveTime;
         } else if (token == "infinite") {       // Search infinitely until stop command called
             limits.isInfinite = true;
+        } else if (token == "ponder") {         // Search the expected position until ponderhit / stop
+            limits.ponder = true;
         }
     }
 
@@ -404,6 +532,11 @@ void Uci::cmdStop() {
 }
 
 
+void Uci::cmdPonderhit() {
+    engine.ponderhit();
+}
+
+
 void Uci::cmdPerft(std::istringstream& is) {
     int depth;
     is >> depth;
@@ -417,6 +550,107 @@ void Uci::cmdPerft(std::istringstream& is) {
     engine.runPerft(depth);
 }
 
+
+void Uci::cmdBench(std::istringstream& is) {
+    Depth depth;
+    std::vector<size_t> hashSizes;
+    size_t hashSize;
+
+    if (!(is >> depth) || depth <= 0) {
+        depth = BENCH_DEFAULT_DEPTH;
+    }
+
+    while (is >> hashSize) {
+        hashSizes.push_back(hashSize);
+    }
+
+    if (hashSizes.empty()) {
+        hashSizes = {16, 64, 256};
+    }
+
+    engine.waitForSearchFinish();
+
+    // Restore the user's hash size once we are done
+    const size_t prevHashSize = engine.getHashSize();
+    bench(engine, depth, hashSizes);
+    engine.setHashSize(prevHashSize);
+}
+
+
+void Uci::cmdLatency(std::istringstream& is) {
+    int iterations;
+
+    if (!(is >> iterations) || iterations <= 0) {
+        iterations = LATENCY_DEFAULT_ITERATIONS;
+    }
+
+    engine.waitForSearchFinish();
+    latency(engine, iterations);
+}
+
+
+void Uci::cmdNps(std::istringstream& is) {
+    TimePoint searchTime;
+    std::vector<size_t> threadCounts;
+    size_t nbThreads;
+
+    if (!(is >> searchTime) || searchTime <= 0) {
+        searchTime = NPS_DEFAULT_SEARCH_TIME;
+    }
+
+    while (is >> nbThreads) {
+        if (nbThreads > 0) threadCounts.push_back(nbThreads);
+    }
+
+    if (threadCounts.empty()) {
+        threadCounts = {1, 2, 4, 8};
+    }
+
+    engine.waitForSearchFinish();
+
+    // Restore the user's thread count once we are done
+    const size_t prevNbThreads = engine.getNbThreads();
+    npsScaling(engine, searchTime, threadCounts);
+    engine.setNbThreads(prevNbThreads);
+}
+
+
+void Uci::cmdSmp(std::istringstream& is) {
+    Depth depth;
+    std::vector<size_t> threadCounts;
+    size_t nbThreads;
+
+    if (!(is >> depth) || depth <= 0) {
+        depth = SMP_DEFAULT_DEPTH;
+    }
+
+    while (is >> nbThreads) {
+        if (nbThreads > 0) threadCounts.push_back(nbThreads);
+    }
+
+    if (threadCounts.empty()) {
+        threadCounts = {1, 2, 4, 8, 16};
+    }
+
+    engine.waitForSearchFinish();
+
+    // Restore the user's thread count once we are done
+    const size_t prevNbThreads = engine.getNbThreads();
+    smpScaling(engine, depth, threadCounts);
+    engine.setNbThreads(prevNbThreads);
+}
+
+
+void Uci::cmdSearchStats() {
+    engine.waitForSearchFinish();
+    searchStats(engine);
+}
+
+void Uci::cmdAllocStats() {
+    engine.waitForSearchFinish();
+    AllocCount::report();
+}
+
 void Uci::cmdDebug() {
     std::cout << engine.getDebugInfo() << std::endl;
 }
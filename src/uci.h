@@ -34,6 +34,8 @@ public:
     static void callbackBestMove(const std::string_view bestmove, const std::string_view ponder);
     static void callbackInfo(const Search::SearchInfo info);
     static void callbackIter(const Depth depth, const Move currmove, const int currmovenumber);
+    static void callbackString(const std::string_view str);
+    static void callbackRootMoveNodes(const Depth depth, const Move move, const uint64_t nodes, const uint64_t rootNodes);
 
 private:
     Engine engine;
@@ -48,8 +50,15 @@ private:
     void cmdSetOption(std::istringstream& is);
     void cmdGo(std::istringstream& is);
     void cmdStop();
+    void cmdPonderhit();
     void cmdQuit();
     void cmdPerft(std::istringstream& is);
+    void cmdBench(std::istringstream& is);
+    void cmdLatency(std::istringstream& is);
+    void cmdNps(std::istringstream& is);
+    void cmdSmp(std::istringstream& is);
+    void cmdSearchStats();
+    void cmdAllocStats();
     void cmdDebug();
     void cmdVisualize(std::istringstream& is);
     void cmdTraceEval();
@@ -0,0 +1,238 @@
+// Reads the search tree traces written by engines built with SEARCH_TRACE=yes
+// (see src/trace.h). Build with "make tracereader".
+//
+//   tracereader <file> summary              Node counts by kind, return reason and ply
+//   tracereader <file> roots                Lists the root searches (iterations and re-searches)
+//   tracereader <file> tree <index> [plies] Prints the subtree of a record, a few plies deep
+//   tracereader <file> hotspots [count]     Positions whose subtrees took the most nodes
+//
+// Records are stored in post-order: the subtree of record i is the
+// subtreeSize records ending at i, its children are found walking back
+// from i - 1, one child subtree at a time.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.h"
+#include "types.h"
+
+using namespace Atom;
+using Trace::Record;
+
+namespace {
+
+const char* REASON_NAMES[Trace::REASON_NB] = {
+    "draw", "aborted", "mate distance", "tt cutoff", "rfp", "razoring", "futility",
+    "null move", "probcut", "qsearch", "stand pat", "no moves", "beta cutoff", "exact", "fail low",
+};
+
+const char* KIND_NAMES[Trace::NODE_KIND_NB] = {
+    "root", "pv", "non-pv", "qs pv", "qs non-pv",
+};
+
+
+std::string formatMove(Move m) {
+    if (m == MOVE_NONE) return "(none)";
+    if (m == MOVE_NULL) return "0000";
+
+    std::string str;
+    for (const Square sq : {moveFrom(m), moveTo(m)}) {
+        str += char('a' + fileOf(sq));
+        str += char('1' + rankOf(sq));
+    }
+
+    if (moveTypeOf(m) == MT_PROMOTION) {
+        str += "?pnbrq?"[movePromotionType(m)];
+    }
+    return str;
+}
+
+
+std::vector<Record> load(const std::string& path) {
+    std::vector<Record> records;
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Error: could not open " << path << std::endl;
+        return records;
+    }
+
+    Record r;
+    while (std::fread(&r, sizeof(Record), 1, file) == 1) {
+        records.push_back(r);
+    }
+
+    std::fclose(file);
+    return records;
+}
+
+
+// Children of record i, in the order they were searched
+std::vector<size_t> children(const std::vector<Record>& records, size_t i) {
+    std::vector<size_t> result;
+
+    const size_t first = i + 1 - records[i].subtreeSize;
+    for (size_t j = i; j > first; j -= records[j - 1].subtreeSize) {
+        result.push_back(j - 1);
+    }
+
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+
+void printRecord(const std::vector<Record>& records, size_t i, int indent) {
+    const Record& r = records[i];
+
+    std::cout << std::setw(10) << i << "  " << std::string(2 * indent, ' ')
+              << formatMove(r.move)
+              << "  " << KIND_NAMES[r.kind]
+              << " ply " << int(r.ply)
+              << " depth " << r.depth
+              << " [" << r.alpha << ", " << r.beta << "]";
+
+    if (r.eval != VALUE_NONE) std::cout << " eval " << r.eval;
+
+    std::cout << " -> " << r.score
+              << " (" << REASON_NAMES[r.reason] << ")";
+
+    if (r.bestMove != MOVE_NONE) std::cout << " best " << formatMove(r.bestMove);
+    if (r.moveCount)             std::cout << " moves " << int(r.moveCount);
+
+    std::cout << " size " << r.subtreeSize << std::endl;
+}
+
+
+void printTree(const std::vector<Record>& records, size_t i, int indent, int maxPlies) {
+    printRecord(records, i, indent);
+
+    if (indent >= maxPlies) return;
+
+    for (const size_t child : children(records, i)) {
+        printTree(records, child, indent + 1, maxPlies);
+    }
+}
+
+
+void summary(const std::vector<Record>& records) {
+    uint64_t byKind[Trace::NODE_KIND_NB]  = {};
+    uint64_t byReason[Trace::REASON_NB]   = {};
+    std::vector<uint64_t> byPly;
+
+    for (const Record& r : records) {
+        ++byKind[r.kind];
+        ++byReason[r.reason];
+
+        if (byPly.size() <= r.ply) byPly.resize(r.ply + 1);
+        ++byPly[r.ply];
+    }
+
+    auto line = [&](const std::string& name, uint64_t count) {
+        std::cout << "  " << std::left << std::setw(16) << name << std::right
+                  << std::setw(13) << count
+                  << std::setw(9) << std::fixed << std::setprecision(2) << 100.0 * count / std::max<size_t>(records.size(), 1) << "%"
+                  << std::endl;
+    };
+
+    std::cout << "Records: " << records.size() << std::endl << std::endl;
+
+    std::cout << "  Kind" << std::endl;
+    for (int k = 0; k < Trace::NODE_KIND_NB; ++k) line(KIND_NAMES[k], byKind[k]);
+
+    std::cout << std::endl << "  Reason" << std::endl;
+    for (int r = 0; r < Trace::REASON_NB; ++r) line(REASON_NAMES[r], byReason[r]);
+
+    std::cout << std::endl << "  Ply" << std::endl;
+    for (size_t p = 0; p < byPly.size(); ++p) line(std::to_string(p), byPly[p]);
+}
+
+
+void roots(const std::vector<Record>& records) {
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].kind == Trace::NODE_ROOT) {
+            printRecord(records, i, 0);
+        }
+    }
+}
+
+
+// Sums the subtree sizes of every visit of each position. A position searched
+// again and again, by transpositions or re-searches, shows up here even if no
+// single visit of it is large.
+void hotspots(const std::vector<Record>& records, size_t count) {
+    struct Hotspot {
+        uint64_t visits = 0, nodes = 0;
+        size_t   lastRecord = 0;
+    };
+
+    std::unordered_map<uint64_t, Hotspot> byHash;
+    for (size_t i = 0; i < records.size(); ++i) {
+        // Root searches contain everything, they would hide the rest
+        if (records[i].kind == Trace::NODE_ROOT) continue;
+
+        Hotspot& h = byHash[records[i].hash];
+        ++h.visits;
+        h.nodes     += records[i].subtreeSize;
+        h.lastRecord = i;
+    }
+
+    std::vector<std::pair<uint64_t, Hotspot>> sorted(byHash.begin(), byHash.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.nodes > b.second.nodes; });
+
+    std::cout << "              Hash   Visits        Nodes   Last record" << std::endl;
+
+    for (size_t i = 0; i < std::min(count, sorted.size()); ++i) {
+        const auto& [hash, h] = sorted[i];
+        std::cout << std::hex << std::setw(18) << hash << std::dec
+                  << std::setw(9) << h.visits
+                  << std::setw(13) << h.nodes
+                  << std::setw(14) << h.lastRecord
+                  << std::endl;
+    }
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: tracereader <file> summary | roots | tree <index> [plies] | hotspots [count]" << std::endl;
+        return 1;
+    }
+
+    const std::vector<Record> records = load(argv[1]);
+    const std::string command = argv[2];
+
+    if (records.empty()) {
+        std::cerr << "Error: no records in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    if (command == "summary") {
+        summary(records);
+    } else if (command == "roots") {
+        roots(records);
+    } else if (command == "tree") {
+        const size_t index = argc > 3 ? std::stoull(argv[3]) : records.size() - 1;
+        const int    plies = argc > 4 ? std::stoi(argv[4]) : 1;
+
+        if (index >= records.size()) {
+            std::cerr << "Error: record " << index << " out of range" << std::endl;
+            return 1;
+        }
+        printTree(records, index, 0, plies);
+    } else if (command == "hotspots") {
+        hotspots(records, argc > 3 ? std::stoull(argv[3]) : 20);
+    } else {
+        std::cerr << "Error: unknown command '" << command << "'" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}